@@ -0,0 +1,37 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "BVH.hpp"
+#include "LinearBVH.hpp"
+#include "WideBVH.hpp"
+
+// Build the structure the integrators trace against.
+//   accel:   list (no acceleration) | bvh (binary LinearBVH) | bvh4 | bvh8
+//   builder: sah (binned SAH) | lbvh (Morton order) | median (BVHNode median split, then flattened)
+// Returns nullptr for "list" or an empty scene; the caller then uses the list itself.
+inline shared_ptr<Hittable> make_accelerator(const std::vector<shared_ptr<Hittable>> &objects, const std::string &accel,
+                                             const std::string &builder, const BVHBuildOptions &options = BVHBuildOptions())
+{
+    if (accel == "list" || objects.empty())
+        return nullptr;
+
+    shared_ptr<LinearBVH> binary;
+    if (builder == "median")
+    {
+        std::vector<shared_ptr<Hittable>> sorted = objects;
+        binary = make_shared<LinearBVH>(BVHNode(sorted, 0, sorted.size(), 0, 0));
+    }
+    else
+    {
+        BVHBuildOptions build_options = options;
+        build_options.method = builder == "lbvh" ? BVHSplitMethod::Morton : BVHSplitMethod::SAH;
+        binary = make_shared<LinearBVH>(objects, build_options);
+    }
+
+    if (accel == "bvh4")
+        return make_shared<BVH4>(*binary);
+    if (accel == "bvh8")
+        return make_shared<BVH8>(*binary);
+    return binary;
+}
@@ -11,21 +11,200 @@
 using std::make_shared;
 using std::shared_ptr;
 
+// Split strategy used when building the tree
+enum class BVHSplitMethod
+{
+    Median, // random axis, median split after a full sort
+    SAH,    // binned surface area heuristic
+    Morton  // LBVH: centroids sorted along a Morton curve, LinearBVHTree only
+};
+
+struct BVHBuildOptions
+{
+    BVHSplitMethod method = BVHSplitMethod::SAH;
+    int bins = 16;                  // centroid bins per axis
+    int max_leaf_size = 4;          // most primitives a leaf may hold
+    double traversal_cost = 1.0;    // relative cost of visiting an inner node
+    double intersection_cost = 1.0; // relative cost of one primitive test
+    int threads = 1;                  // LinearBVHTree builds subtrees and bins in parallel when > 1
+    size_t parallel_threshold = 4096; // smallest primitive range that is split into parallel work
+    int morton_bits = 63;             // Morton code length, 30 (10 bits per axis) or 63 (21 bits per axis)
+};
+
+// Box and centroid of one primitive, computed once before an SAH build
+struct BVHPrimRef
+{
+    aabb box;
+    Vec3 centroid;
+    size_t index;
+};
+
+struct SAHSplit
+{
+    int axis = -1; // -1 when no split beats the leaf cost
+    int bin = 0;   // primitives in bins [0, bin] go left
+    double cost = inf;
+};
+
+// Pointer-based BVH. It is only built, never updated: time0 / time1 select
+// the primitive boxes of the SAH build (the median build ignores them) and
+// there is no refit. Scenes with moving primitives flatten it into a
+// LinearBVH, whose refit() and update() take the new time interval.
 class BVHNode : public Hittable
 {
 public:
     shared_ptr<Hittable> left;
     shared_ptr<Hittable> right;
+    std::vector<shared_ptr<Hittable>> primitives; // non-empty only for SAH leaves
     aabb box;
+    int axis = 0; // split axis of an inner node, left holds the lower side
 
     BVHNode() {}
 
     BVHNode(std::vector<shared_ptr<Hittable>> &objects, size_t start, size_t end, double time0, double time1);
 
+    BVHNode(std::vector<shared_ptr<Hittable>> &objects, size_t start, size_t end, double time0, double time1,
+            const BVHBuildOptions &options);
+
+    // Recursive SAH build over precomputed primitive references
+    BVHNode(const std::vector<shared_ptr<Hittable>> &objects, std::vector<BVHPrimRef> &refs, size_t start, size_t end,
+            const BVHBuildOptions &options);
+
     bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const override;
     bool bounding_box(double t0, double t1, aabb &output_box) const override;
+
+    bool occluded(const Ray &r, double t_min, double t_max) const override;
+
+    // Traversal with the ray's inverse direction computed once at the root
+    bool hit(const Ray &r, const RayPrecomp &pr, double t_min, double t_max, Hit_record &rec) const;
+    bool occluded(const Ray &r, const RayPrecomp &pr, double t_min, double t_max) const;
+
+    bool is_leaf() const { return !primitives.empty(); }
+
+    // Number of BVHNode objects in this subtree
+    size_t node_count() const;
+
+    // Expected cost of a random ray under the surface area heuristic
+    double sah_cost(const BVHBuildOptions &options) const;
+
+private:
+    // Children that are BVHNodes, so traversal can pass the RayPrecomp down
+    const BVHNode *left_node = nullptr;
+    const BVHNode *right_node = nullptr;
+
+    void cache_child_nodes()
+    {
+        left_node = dynamic_cast<const BVHNode *>(left.get());
+        right_node = dynamic_cast<const BVHNode *>(right.get());
+    }
+};
+
+inline int sah_bin_index(const Vec3 &centroid, const aabb &centroid_bounds, int axis, int bins)
+{
+    float lo = axis_value(centroid_bounds.min(), axis);
+    float extent = axis_value(centroid_bounds.max(), axis) - lo;
+    int b = static_cast<int>(bins * ((axis_value(centroid, axis) - lo) / extent));
+    return std::min(std::max(b, 0), bins - 1);
+}
+
+// Bounding boxes and counts of the centroid bins on all three axes
+struct SAHBins
+{
+    int bins;
+    std::vector<aabb> box;      // [axis * bins + bin]
+    std::vector<size_t> count;  // [axis * bins + bin]
+    bool axis_used[3];          // false when all centroids share one coordinate on that axis
+
+    SAHBins(int bins, const aabb &centroid_bounds)
+        : bins(bins), box(3 * bins, aabb::empty()), count(3 * bins, 0)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+            axis_used[axis] = axis_value(centroid_bounds.max(), axis) > axis_value(centroid_bounds.min(), axis);
+    }
+
+    void add(const BVHPrimRef &ref, const aabb &centroid_bounds)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (!axis_used[axis])
+                continue;
+            int b = axis * bins + sah_bin_index(ref.centroid, centroid_bounds, axis, bins);
+            box[b] = surrounding_box(box[b], ref.box);
+            count[b]++;
+        }
+    }
+
+    void merge(const SAHBins &other)
+    {
+        for (size_t b = 0; b < box.size(); ++b)
+        {
+            box[b] = surrounding_box(box[b], other.box[b]);
+            count[b] += other.count[b];
+        }
+    }
 };
 
+// Cheapest split plane over filled bins
+inline SAHSplit best_sah_split(const SAHBins &binned, const aabb &bounds, const BVHBuildOptions &options)
+{
+    SAHSplit best;
+    const int bins = binned.bins;
+    const double inv_area = 1.0 / bounds.surface_area();
+
+    std::vector<double> right_area(bins);
+    std::vector<size_t> right_count(bins);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (!binned.axis_used[axis])
+            continue;
+        const aabb *bin_box = &binned.box[axis * bins];
+        const size_t *bin_count = &binned.count[axis * bins];
+
+        // Sweep from the right to get the area and count of every right-hand side
+        aabb acc = aabb::empty();
+        size_t count = 0;
+        for (int b = bins - 1; b > 0; --b)
+        {
+            acc = surrounding_box(acc, bin_box[b]);
+            count += bin_count[b];
+            right_area[b] = count ? acc.surface_area() : 0.0;
+            right_count[b] = count;
+        }
+
+        acc = aabb::empty();
+        count = 0;
+        for (int b = 0; b < bins - 1; ++b)
+        {
+            acc = surrounding_box(acc, bin_box[b]);
+            count += bin_count[b];
+            if (count == 0 || right_count[b + 1] == 0)
+                continue;
+
+            double cost = options.traversal_cost +
+                          options.intersection_cost * inv_area *
+                              (acc.surface_area() * count + right_area[b + 1] * right_count[b + 1]);
+            if (cost < best.cost)
+            {
+                best.axis = axis;
+                best.bin = b;
+                best.cost = cost;
+            }
+        }
+    }
+    return best;
+}
+
+// Bin the centroids of refs[start, end) along every axis and return the cheapest split plane
+inline SAHSplit find_sah_split(const std::vector<BVHPrimRef> &refs, size_t start, size_t end,
+                               const aabb &bounds, const aabb &centroid_bounds, const BVHBuildOptions &options)
+{
+    SAHBins binned(std::max(options.bins, 2), centroid_bounds);
+    for (size_t i = start; i < end; ++i)
+        binned.add(refs[i], centroid_bounds);
+    return best_sah_split(binned, bounds, options);
+}
+
 inline bool box_compare(const shared_ptr<Hittable> a, const shared_ptr<Hittable> b, int axis)
 {
     aabb box_a;
@@ -37,8 +216,7 @@ inline bool box_compare(const shared_ptr<Hittable> a, const shared_ptr<Hittable>
         return box_a.min().x < box_b.min().x;
     if (axis == 1)
         return box_a.min().y < box_b.min().y;
-    if (axis == 2)
-        return box_a.min().z < box_b.min().z;
+    return box_a.min().z < box_b.min().z;
 }
 
 bool box_x_compare(const shared_ptr<Hittable> a, const shared_ptr<Hittable> b)
@@ -58,7 +236,7 @@ bool box_z_compare(const shared_ptr<Hittable> a, const shared_ptr<Hittable> b)
 
 BVHNode::BVHNode(std::vector<shared_ptr<Hittable>> &objects, size_t start, size_t end, double time0, double time1)
 {
-    int axis = random_int(0, 2);
+    axis = random_int(0, 2);
     auto comparator = (axis == 0)   ? box_x_compare
                       : (axis == 1) ? box_y_compare
                                     : box_z_compare;
@@ -96,6 +274,109 @@ BVHNode::BVHNode(std::vector<shared_ptr<Hittable>> &objects, size_t start, size_
         std::cerr << "No bounding box in BVHNode constructor.\n";
 
     box = surrounding_box(box_left, box_right);
+    cache_child_nodes();
+}
+
+BVHNode::BVHNode(std::vector<shared_ptr<Hittable>> &objects, size_t start, size_t end, double time0, double time1,
+                 const BVHBuildOptions &options)
+{
+    if (options.method == BVHSplitMethod::Median)
+    {
+        *this = BVHNode(objects, start, end, time0, time1);
+        return;
+    }
+
+    std::vector<BVHPrimRef> refs;
+    refs.reserve(end - start);
+    for (size_t i = start; i < end; ++i)
+    {
+        aabb b;
+        if (!objects[i]->bounding_box(time0, time1, b))
+            std::cerr << "No bounding box in BVHNode constructor.\n";
+        refs.push_back({b, b.centroid(), i});
+    }
+
+    *this = BVHNode(objects, refs, 0, refs.size(), options);
+}
+
+BVHNode::BVHNode(const std::vector<shared_ptr<Hittable>> &objects, std::vector<BVHPrimRef> &refs, size_t start, size_t end,
+                 const BVHBuildOptions &options)
+{
+    box = aabb::empty();
+    aabb centroid_bounds = aabb::empty();
+    for (size_t i = start; i < end; ++i)
+    {
+        box = surrounding_box(box, refs[i].box);
+        centroid_bounds = surrounding_box(centroid_bounds, refs[i].centroid);
+    }
+
+    size_t object_span = end - start;
+    if (object_span == 1)
+    {
+        primitives.push_back(objects[refs[start].index]);
+        return;
+    }
+
+    SAHSplit split = find_sah_split(refs, start, end, box, centroid_bounds, options);
+    double leaf_cost = options.intersection_cost * object_span;
+    bool fits_leaf = object_span <= static_cast<size_t>(std::max(options.max_leaf_size, 1));
+
+    if (fits_leaf && (split.axis < 0 || leaf_cost <= split.cost))
+    {
+        for (size_t i = start; i < end; ++i)
+            primitives.push_back(objects[refs[i].index]);
+        return;
+    }
+
+    size_t mid;
+    axis = split.axis >= 0 ? split.axis : box.longest_axis();
+    if (split.axis >= 0)
+    {
+        auto middle = std::partition(refs.begin() + start, refs.begin() + end, [&](const BVHPrimRef &ref)
+                                     { return sah_bin_index(ref.centroid, centroid_bounds, split.axis, std::max(options.bins, 2)) <= split.bin; });
+        mid = middle - refs.begin();
+    }
+    else
+    {
+        // All centroids coincide, so binning cannot separate them: split the range in half
+        mid = start + object_span / 2;
+        std::nth_element(refs.begin() + start, refs.begin() + mid, refs.begin() + end,
+                         [axis = axis](const BVHPrimRef &a, const BVHPrimRef &b)
+                         { return axis_value(a.centroid, axis) < axis_value(b.centroid, axis); });
+    }
+
+    left = make_shared<BVHNode>(objects, refs, start, mid, options);
+    right = make_shared<BVHNode>(objects, refs, mid, end, options);
+    cache_child_nodes();
+}
+
+size_t BVHNode::node_count() const
+{
+    size_t count = 1;
+    for (const auto &child : {left, right})
+    {
+        if (auto node = std::dynamic_pointer_cast<BVHNode>(child))
+            count += node->node_count();
+    }
+    return count;
+}
+
+double BVHNode::sah_cost(const BVHBuildOptions &options) const
+{
+    if (is_leaf())
+        return options.intersection_cost * primitives.size();
+
+    double cost = options.traversal_cost;
+    double inv_area = 1.0 / box.surface_area();
+    for (const auto &child : {left, right})
+    {
+        aabb child_box;
+        child->bounding_box(0, 0, child_box);
+        auto node = std::dynamic_pointer_cast<BVHNode>(child);
+        double child_cost = node ? node->sah_cost(options) : options.intersection_cost;
+        cost += child_box.surface_area() * inv_area * child_cost;
+    }
+    return cost;
 }
 
 bool BVHNode::bounding_box(double t0, double t1, aabb &output_box) const
@@ -106,11 +387,56 @@ bool BVHNode::bounding_box(double t0, double t1, aabb &output_box) const
 
 bool BVHNode::hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const
 {
-    if (!box.hit(r, t_min, t_max))
+    return hit(r, RayPrecomp(r), t_min, t_max, rec);
+}
+
+bool BVHNode::hit(const Ray &r, const RayPrecomp &pr, double t_min, double t_max, Hit_record &rec) const
+{
+    if (!box.hit(pr, static_cast<float>(t_min), static_cast<float>(t_max)))
         return false;
 
-    bool hit_left = left->hit(r, t_min, t_max, rec);
-    bool hit_right = right->hit(r, t_min, hit_left ? rec.t : t_max, rec);
+    if (is_leaf())
+    {
+        bool hit_anything = false;
+        for (const auto &object : primitives)
+        {
+            if (object->hit(r, t_min, t_max, rec))
+            {
+                hit_anything = true;
+                t_max = rec.t;
+            }
+        }
+        return hit_anything;
+    }
+
+    bool hit_left = left_node ? left_node->hit(r, pr, t_min, t_max, rec) : left->hit(r, t_min, t_max, rec);
+    double closest = hit_left ? rec.t : t_max;
+    bool hit_right = right_node ? right_node->hit(r, pr, t_min, closest, rec) : right->hit(r, t_min, closest, rec);
 
     return hit_left || hit_right;
-}
\ No newline at end of file
+}
+
+bool BVHNode::occluded(const Ray &r, double t_min, double t_max) const
+{
+    return occluded(r, RayPrecomp(r), t_min, t_max);
+}
+
+bool BVHNode::occluded(const Ray &r, const RayPrecomp &pr, double t_min, double t_max) const
+{
+    if (!box.hit(pr, static_cast<float>(t_min), static_cast<float>(t_max)))
+        return false;
+
+    if (is_leaf())
+    {
+        for (const auto &object : primitives)
+        {
+            if (object->occluded(r, t_min, t_max))
+                return true;
+        }
+        return false;
+    }
+
+    if (left_node ? left_node->occluded(r, pr, t_min, t_max) : left->occluded(r, t_min, t_max))
+        return true;
+    return right_node ? right_node->occluded(r, pr, t_min, t_max) : right->occluded(r, t_min, t_max);
+}
@@ -0,0 +1,860 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <iomanip>
+#include <limits>
+#include "SceneParser.hpp"
+#include "BVH.hpp"
+#include "LinearBVH.hpp"
+#include "WideBVH.hpp"
+#include "TriangleMesh.hpp"
+#include "MeshLoader.hpp"
+#include "Accelerator.hpp"
+#include "Instance.hpp"
+#include "SphereSet.hpp"
+#include "Integrators.hpp"
+
+// Acceleration structure benchmarks.
+// Usage: ./Benchmark [name|all] [scene.json]
+
+struct SceneData
+{
+    Camera camera;
+    std::vector<shared_ptr<Hittable>> objects;
+};
+
+SceneData load_scene(const std::string &path)
+{
+    std::ifstream file(path);
+    json j;
+    file >> j;
+
+    SceneData scene;
+    scene.camera = parseCamera(j);
+    hittable_list world;
+    parseScene(j, world, std::filesystem::path(path).parent_path().string());
+    scene.objects = world.objects;
+    return scene;
+}
+
+// Small random triangles scattered in a [-1, 1]^3 cube
+std::vector<shared_ptr<Hittable>> make_triangle_soup(size_t count, float size = 0.02f)
+{
+    seed_thread_rng(7, 0);
+    auto material = std::static_pointer_cast<Material>(make_shared<Diffuse>(Vec3(0.5, 0.5, 0.5)));
+    std::vector<shared_ptr<Hittable>> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vec3 p = Vec3::random(-1, 1);
+        objects.push_back(make_shared<Triangle>(p, p + size * Vec3::random(-1, 1), p + size * Vec3::random(-1, 1), material));
+    }
+    return objects;
+}
+
+// One primary ray per pixel of the scene camera
+std::vector<Ray> camera_rays(const Camera &camera)
+{
+    std::vector<Ray> rays;
+    rays.reserve(camera.width * camera.height);
+    for (int y = 0; y < camera.height; ++y)
+        for (int x = 0; x < camera.width; ++x)
+            rays.push_back(camera.get_ray(float(x) / (camera.width - 1), float(y) / (camera.height - 1)));
+    return rays;
+}
+
+// Rays from a sphere of radius 3 towards random points inside the unit cube
+std::vector<Ray> soup_rays(size_t count)
+{
+    std::vector<Ray> rays;
+    rays.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vec3 origin = 3.0 * random_unit_vector();
+        rays.emplace_back(origin, Vec3::random(-1, 1) - origin);
+    }
+    return rays;
+}
+
+template <typename Fn>
+double time_seconds(Fn &&fn)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    return elapsed.count();
+}
+
+void report(const std::string &label, double build_s, double trace_s, size_t rays, size_t hits)
+{
+    std::cout << "  " << label << ": build " << build_s * 1000 << " ms, trace " << trace_s * 1000 << " ms, "
+              << rays / trace_s / 1e6 << " Mrays/s, " << hits << " hits\n";
+}
+
+size_t trace_closest(const Hittable &world, const std::vector<Ray> &rays)
+{
+    size_t hits = 0;
+    Hit_record rec;
+    for (const Ray &r : rays)
+        hits += world.hit(r, 0.001, inf, rec);
+    return hits;
+}
+
+void compare_pointer_and_linear(const std::string &name, std::vector<shared_ptr<Hittable>> objects, const std::vector<Ray> &rays)
+{
+    std::cout << name << " (" << objects.size() << " primitives, " << rays.size() << " rays)\n";
+    BVHBuildOptions options;
+
+    shared_ptr<BVHNode> tree;
+    double build = time_seconds([&] { tree = make_shared<BVHNode>(objects, 0, objects.size(), 0, 0, options); });
+    size_t hits = 0;
+    double trace = time_seconds([&] { hits = trace_closest(*tree, rays); });
+    report("BVHNode (pointer tree)", build, trace, rays.size(), hits);
+
+    shared_ptr<LinearBVH> flat;
+    build = time_seconds([&] { flat = make_shared<LinearBVH>(*tree); });
+    trace = time_seconds([&] { hits = trace_closest(*flat, rays); });
+    report("LinearBVH (flattened BVHNode)", build, trace, rays.size(), hits);
+
+    build = time_seconds([&] { flat = make_shared<LinearBVH>(objects, options); });
+    trace = time_seconds([&] { hits = trace_closest(*flat, rays); });
+    report("LinearBVH (direct build)", build, trace, rays.size(), hits);
+    std::cout << "  nodes: " << flat->tree.nodes.size() << " x " << sizeof(LinearBVHNode) << " bytes\n";
+}
+
+void bench_linear(const std::string &scene_path)
+{
+    SceneData scene = load_scene(scene_path);
+    compare_pointer_and_linear(scene_path, scene.objects, camera_rays(scene.camera));
+    compare_pointer_and_linear("triangle soup", make_triangle_soup(200000), soup_rays(200000));
+}
+
+void compare_wide(const std::string &name, const std::vector<shared_ptr<Hittable>> &objects, const std::vector<Ray> &rays)
+{
+    std::cout << name << " (" << objects.size() << " primitives, " << rays.size() << " rays)\n";
+    size_t hits = 0;
+    LinearBVH binary(objects);
+    double trace = time_seconds([&] { hits = trace_closest(binary, rays); });
+    report("LinearBVH (binary)", 0, trace, rays.size(), hits);
+
+    for (bool simd : {false, true})
+    {
+        shared_ptr<BVH4> bvh4;
+        double build = time_seconds([&] { bvh4 = make_shared<BVH4>(binary, simd); });
+        trace = time_seconds([&] { hits = trace_closest(*bvh4, rays); });
+        report(std::string("BVH4 ") + (bvh4->uses_simd() ? "SSE" : "scalar"), build, trace, rays.size(), hits);
+
+        shared_ptr<BVH8> bvh8;
+        build = time_seconds([&] { bvh8 = make_shared<BVH8>(binary, simd); });
+        trace = time_seconds([&] { hits = trace_closest(*bvh8, rays); });
+        report(std::string("BVH8 ") + (bvh8->uses_simd() ? "AVX" : "scalar"), build, trace, rays.size(), hits);
+    }
+}
+
+void bench_wide(const std::string &scene_path)
+{
+    SceneData scene = load_scene(scene_path);
+    compare_wide(scene_path, scene.objects, camera_rays(scene.camera));
+    compare_wide("triangle soup", make_triangle_soup(200000), soup_rays(200000));
+}
+
+// Trace the same rays split across 1, 2, 4, ... threads. Every hit writes a
+// material pointer into the record, so shared state on the hit path shows up
+// as sub-linear scaling.
+void thread_scaling(const std::string &name, const Hittable &world, const std::vector<Ray> &rays)
+{
+    std::cout << name << " (" << rays.size() << " rays)\n";
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> counts;
+    for (int n = 1; n < max_threads; n *= 2)
+        counts.push_back(n);
+    counts.push_back(max_threads);
+
+    double single = 0;
+    for (int n : counts)
+    {
+        std::vector<size_t> hits(n);
+        double trace = time_seconds([&]
+                                    {
+            std::vector<std::thread> threads;
+            for (int t = 0; t < n; ++t)
+                threads.emplace_back([&, t]
+                                     {
+                    Hit_record rec;
+                    for (size_t i = t; i < rays.size(); i += n)
+                        if (world.hit(rays[i], 0.001, inf, rec) && rec.mat_ptr)
+                            hits[t]++; });
+            for (auto &thread : threads)
+                thread.join(); });
+        if (n == 1)
+            single = trace;
+        std::cout << "  " << n << " threads: " << rays.size() / trace / 1e6 << " Mrays/s, speedup "
+                  << single / trace << "x (ideal " << n << "x)\n";
+    }
+}
+
+void bench_threads(const std::string &scene_path)
+{
+    SceneData scene = load_scene(scene_path);
+    std::vector<Ray> rays = camera_rays(scene.camera);
+    hittable_list list;
+    list.objects = scene.objects;
+    thread_scaling(scene_path + ", hittable_list", list, rays);
+    thread_scaling("triangle soup, LinearBVH", LinearBVH(make_triangle_soup(200000)), soup_rays(200000));
+}
+
+// Triangle with the previous bounding box: a cube around the bounding sphere of the centroid
+class LooseTriangle : public Triangle
+{
+public:
+    using Triangle::Triangle;
+
+    bool bounding_box(double t0, double t1, aabb &output_box) const override
+    {
+        Vec3 center = (v1 + v2 + v3) / 3;
+        double radius = std::max({(center - v1).length(), (center - v2).length(), (center - v3).length()});
+        output_box = aabb(center - Vec3(radius, radius, radius), center + Vec3(radius, radius, radius));
+        return true;
+    }
+};
+
+// Height field of nx x nz cells over [-1, 1]^2, stretched so the triangles are long and thin
+template <typename TriangleType>
+std::vector<shared_ptr<Hittable>> make_sliver_grid(int nx, int nz)
+{
+    auto material = std::static_pointer_cast<Material>(make_shared<Diffuse>(Vec3(0.5, 0.5, 0.5)));
+    auto vertex = [&](int i, int j)
+    {
+        float x = 2.0f * i / nx - 1, z = 2.0f * j / nz - 1;
+        return Vec3(x, 0.1f * std::sin(7 * x) * std::cos(5 * z), z);
+    };
+    std::vector<shared_ptr<Hittable>> objects;
+    for (int j = 0; j < nz; ++j)
+        for (int i = 0; i < nx; ++i)
+        {
+            objects.push_back(make_shared<TriangleType>(vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1), material));
+            objects.push_back(make_shared<TriangleType>(vertex(i, j), vertex(i + 1, j + 1), vertex(i, j + 1), material));
+        }
+    return objects;
+}
+
+void traversal_stats(const std::string &label, const LinearBVH &bvh, const std::vector<Ray> &rays)
+{
+    TraversalStats stats;
+    size_t hits = 0;
+    double trace = time_seconds([&]
+                                {
+        for (const Ray &r : rays)
+        {
+            Hit_record rec;
+            hits += bvh.tree.traverse_counted(r, 0.001, inf, [&](uint32_t slot, double &closest)
+                                              {
+                if (!bvh.primitives[slot]->hit(r, 0.001, closest, rec))
+                    return false;
+                closest = rec.t;
+                return true; }, stats);
+        } });
+    std::cout << "  " << label << ": " << double(stats.node_tests) / stats.rays << " box tests/ray, "
+              << double(stats.primitive_tests) / stats.rays << " primitive tests/ray, trace " << trace * 1000
+              << " ms, " << hits << " hits, " << bvh.tree.nodes.size() << " nodes\n";
+}
+
+// Bounding-sphere cube vs. exact vertex boxes for long thin triangles
+void bench_bounds()
+{
+    const int nx = 2000, nz = 50;
+    std::vector<Ray> rays;
+    seed_thread_rng(11, 0);
+    for (int i = 0; i < 200000; ++i)
+    {
+        Vec3 origin = Vec3(random_double(-1, 1), 2, random_double(-1, 1));
+        rays.emplace_back(origin, Vec3(random_double(-0.5, 0.5), -1, random_double(-0.5, 0.5)));
+    }
+    std::cout << "sliver grid (" << 2 * nx * nz << " triangles, " << rays.size() << " rays)\n";
+    traversal_stats("bounding-sphere boxes", LinearBVH(make_sliver_grid<LooseTriangle>(nx, nz)), rays);
+    traversal_stats("vertex boxes", LinearBVH(make_sliver_grid<Triangle>(nx, nz)), rays);
+}
+
+// The triangle soup as separate Triangle objects under a LinearBVH and as
+// one indexed TriangleMesh, same rays, memory without BVH nodes
+void bench_mesh()
+{
+    const size_t count = 200000;
+    std::vector<shared_ptr<Hittable>> objects = make_triangle_soup(count);
+    std::vector<Ray> rays = soup_rays(count);
+    std::cout << "triangle soup (" << count << " triangles, " << rays.size() << " rays)\n";
+
+    size_t hits = 0;
+    shared_ptr<LinearBVH> list;
+    double build = time_seconds([&] { list = make_shared<LinearBVH>(objects); });
+    double trace = time_seconds([&] { hits = trace_closest(*list, rays); });
+    report("Triangle objects", build, trace, rays.size(), hits);
+    // make_shared puts the object and a 16-byte control block in one heap block
+    size_t object_bytes = sizeof(Triangle) + 16 + sizeof(shared_ptr<Hittable>);
+    std::cout << "  memory: " << object_bytes << " bytes per triangle\n";
+
+    std::vector<Vec3> positions;
+    std::vector<uint32_t> indices;
+    positions.reserve(3 * count);
+    indices.reserve(3 * count);
+    for (const auto &object : objects)
+    {
+        auto triangle = std::static_pointer_cast<Triangle>(object);
+        for (const Vec3 &p : {triangle->v1, triangle->v2, triangle->v3})
+        {
+            indices.push_back(static_cast<uint32_t>(positions.size()));
+            positions.push_back(p);
+        }
+    }
+    auto material = std::static_pointer_cast<Triangle>(objects[0])->mat_ptr;
+    objects.clear();
+
+    shared_ptr<TriangleMesh> mesh;
+    build = time_seconds([&] { mesh = make_shared<TriangleMesh>(std::move(positions), std::move(indices), material); });
+    trace = time_seconds([&] { hits = trace_closest(*mesh, rays); });
+    report("TriangleMesh", build, trace, rays.size(), hits);
+    size_t mesh_bytes = mesh->positions.size() * sizeof(Vec3) + mesh->indices.size() * sizeof(uint32_t);
+    std::cout << "  memory: " << double(mesh_bytes) / count << " bytes per triangle (unshared vertices)\n";
+}
+
+// n x n height-field grid written as OBJ text and as binary little-endian PLY
+void write_grid_files(int n, const std::string &obj_path, const std::string &ply_path)
+{
+    std::vector<Vec3> vertices;
+    for (int j = 0; j <= n; ++j)
+        for (int i = 0; i <= n; ++i)
+        {
+            float x = 2.0f * i / n - 1, z = 2.0f * j / n - 1;
+            vertices.emplace_back(x, 0.2f * std::sin(3 * x) * std::cos(3 * z), z);
+        }
+    std::vector<uint32_t> indices;
+    for (int j = 0; j < n; ++j)
+        for (int i = 0; i < n; ++i)
+        {
+            uint32_t a = j * (n + 1) + i;
+            for (uint32_t index : {a, a + 1, a + n + 2, a, a + n + 2, a + n + 1})
+                indices.push_back(index);
+        }
+
+    std::ofstream obj(obj_path);
+    for (const Vec3 &v : vertices)
+        obj << "v " << v.x << ' ' << v.y << ' ' << v.z << '\n';
+    for (size_t i = 0; i < indices.size(); i += 3)
+        obj << "f " << indices[i] + 1 << ' ' << indices[i + 1] + 1 << ' ' << indices[i + 2] + 1 << '\n';
+
+    std::ofstream ply(ply_path, std::ios::binary);
+    ply << "ply\nformat binary_little_endian 1.0\nelement vertex " << vertices.size()
+        << "\nproperty float x\nproperty float y\nproperty float z\nelement face " << indices.size() / 3
+        << "\nproperty list uchar int vertex_indices\nend_header\n";
+    ply.write(reinterpret_cast<const char *>(vertices.data()), vertices.size() * sizeof(Vec3));
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        uint8_t count = 3;
+        ply.write(reinterpret_cast<const char *>(&count), 1);
+        ply.write(reinterpret_cast<const char *>(&indices[i]), 3 * sizeof(uint32_t));
+    }
+}
+
+// Mesh loader throughput on a 2M triangle grid, from the page cache
+void bench_load()
+{
+    std::string dir = std::filesystem::temp_directory_path().string();
+    std::string obj_path = dir + "/benchmark_grid.obj", ply_path = dir + "/benchmark_grid.ply";
+    write_grid_files(1000, obj_path, ply_path);
+
+    for (const std::string &path : {obj_path, ply_path})
+    {
+        double mb = std::filesystem::file_size(path) / 1e6;
+        std::cout << path << " (" << mb << " MB)\n";
+        for (int threads : {1, default_thread_count()})
+        {
+            MeshData mesh;
+            std::string error;
+            double load = time_seconds([&] { load_mesh(path, mesh, error, threads); });
+            std::cout << "  " << threads << " threads: " << load * 1000 << " ms, " << mb / load << " MB/s, "
+                      << mesh.indices.size() / 3 << " triangles" << (error.empty() ? "" : ", error: " + error) << "\n";
+            if (default_thread_count() == 1)
+                break;
+        }
+        std::filesystem::remove(path);
+    }
+}
+
+// Random spheres in [-1, 1]^3, radius shrinking with the count so the cube stays about as full
+std::vector<shared_ptr<Hittable>> make_spheres(size_t count)
+{
+    seed_thread_rng(13, 0);
+    auto material = std::static_pointer_cast<Material>(make_shared<Diffuse>(Vec3(0.5, 0.5, 0.5)));
+    float radius = 0.5f / std::cbrt(float(count));
+    std::vector<shared_ptr<Hittable>> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        objects.push_back(make_shared<Sphere>(Vec3::random(-1, 1), radius, material));
+    return objects;
+}
+
+// Closest-hit cost per ray from 10 to 100k primitives, list vs. each accelerator.
+// The list traces fewer rays at large counts to keep the run short.
+void bench_scaling()
+{
+    std::vector<Ray> rays = soup_rays(20000);
+    std::cout << "spheres, " << rays.size() << " rays, microseconds per ray\n";
+    std::cout << "  primitives        list         bvh        bvh4        bvh8\n";
+    for (size_t count = 10; count <= 100000; count *= 10)
+    {
+        std::vector<shared_ptr<Hittable>> objects = make_spheres(count);
+        std::cout << "  " << std::setw(10) << count;
+        for (const char *accel : {"list", "bvh", "bvh4", "bvh8"})
+        {
+            shared_ptr<Hittable> world = make_accelerator(objects, accel, "sah");
+            hittable_list list;
+            if (!world)
+                list.objects = objects;
+            size_t n_rays = world ? rays.size() : std::min(rays.size(), size_t(2e8) / count);
+            std::vector<Ray> subset(rays.begin(), rays.begin() + n_rays);
+            double trace = time_seconds([&] { trace_closest(world ? *world : list, subset); });
+            std::cout << std::setw(12) << trace / n_rays * 1e6;
+        }
+        std::cout << "\n";
+    }
+}
+
+// Boxes of small random triangles, as build input without the Triangle objects
+std::vector<BVHPrimRef> random_triangle_refs(size_t count)
+{
+    seed_thread_rng(17, 0);
+    std::vector<BVHPrimRef> refs;
+    refs.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vec3 p = Vec3::random(-1, 1);
+        aabb box = surrounding_box(surrounding_box(aabb(p, p), p + 0.01 * Vec3::random(-1, 1)), p + 0.01 * Vec3::random(-1, 1));
+        refs.push_back({box, box.centroid(), i});
+    }
+    return refs;
+}
+
+// Serial vs. parallel LinearBVHTree build over 1M primitives
+void bench_build()
+{
+    const size_t count = 1000000;
+    std::vector<BVHPrimRef> source = random_triangle_refs(count);
+    std::cout << "random triangle boxes (" << count << " primitives)\n";
+
+    std::vector<int> thread_counts = {1};
+    if (default_thread_count() > 1)
+        thread_counts.push_back(default_thread_count());
+    for (int threads : thread_counts)
+    {
+        BVHBuildOptions options;
+        options.threads = threads;
+        std::vector<BVHPrimRef> refs = source;
+        LinearBVHTree tree;
+        double build = time_seconds([&] { tree.build(refs, options); });
+        std::cout << "  " << threads << " threads: build " << build * 1000 << " ms, SAH cost " << tree.sah_cost(options)
+                  << ", " << tree.nodes.size() << " nodes\n";
+    }
+}
+
+// Binned SAH vs. LBVH with 30 and 63-bit Morton codes: build time, SAH cost and trace time
+void bench_lbvh()
+{
+    struct Builder
+    {
+        const char *label;
+        BVHSplitMethod method;
+        int morton_bits;
+    };
+    const Builder builders[] = {{"SAH", BVHSplitMethod::SAH, 63},
+                                {"LBVH 30-bit", BVHSplitMethod::Morton, 30},
+                                {"LBVH 63-bit", BVHSplitMethod::Morton, 63}};
+
+    const size_t count = 1000000;
+    std::vector<BVHPrimRef> source = random_triangle_refs(count);
+    std::cout << "random triangle boxes (" << count << " primitives, " << default_thread_count() << " threads)\n";
+    for (const Builder &builder : builders)
+    {
+        BVHBuildOptions options;
+        options.method = builder.method;
+        options.morton_bits = builder.morton_bits;
+        options.threads = default_thread_count();
+        std::vector<BVHPrimRef> refs = source;
+        LinearBVHTree tree;
+        double build = time_seconds([&] { tree.build(refs, options); });
+        std::cout << "  " << builder.label << ": build " << build * 1000 << " ms, SAH cost " << tree.sah_cost(options) << "\n";
+    }
+
+    std::vector<shared_ptr<Hittable>> objects = make_triangle_soup(200000);
+    std::vector<Ray> rays = soup_rays(200000);
+    std::cout << "triangle soup (" << objects.size() << " primitives, " << rays.size() << " rays)\n";
+    for (const Builder &builder : builders)
+    {
+        BVHBuildOptions options;
+        options.method = builder.method;
+        options.morton_bits = builder.morton_bits;
+        options.threads = default_thread_count();
+        shared_ptr<LinearBVH> bvh;
+        size_t hits = 0;
+        double build = time_seconds([&] { bvh = make_shared<LinearBVH>(objects, options); });
+        double trace = time_seconds([&] { hits = trace_closest(*bvh, rays); });
+        report(builder.label, build, trace, rays.size(), hits);
+    }
+}
+
+// Triangle soup whose triangles drift apart with random velocities. Every
+// frame one mesh is only refit, one is rebuilt from scratch and one refits
+// until its SAH cost passes 1.5x the last build, then rebuilds.
+void bench_refit()
+{
+    const size_t count = 100000;
+    const int frames = 10;
+    std::vector<shared_ptr<Hittable>> objects = make_triangle_soup(count);
+    std::vector<Ray> rays = soup_rays(count);
+    std::vector<Vec3> positions;
+    std::vector<uint32_t> indices;
+    std::vector<Vec3> velocities;
+    for (const auto &object : objects)
+    {
+        auto triangle = std::static_pointer_cast<Triangle>(object);
+        Vec3 velocity = 0.005 * Vec3::random(-1, 1);
+        for (const Vec3 &p : {triangle->v1, triangle->v2, triangle->v3})
+        {
+            indices.push_back(static_cast<uint32_t>(positions.size()));
+            positions.push_back(p);
+            velocities.push_back(velocity);
+        }
+    }
+    auto material = std::static_pointer_cast<Triangle>(objects[0])->mat_ptr;
+    std::cout << "moving triangle soup (" << count << " triangles, " << rays.size() << " rays, " << frames << " frames)\n";
+
+    TriangleMesh refit(positions, indices, material);
+    TriangleMesh rebuilt(positions, indices, material);
+    TriangleMesh adaptive(positions, indices, material);
+    // The index buffers are reordered per mesh, so vertices are moved by vertex index
+    auto advance = [&](TriangleMesh &mesh)
+    {
+        for (size_t i = 0; i < mesh.positions.size(); ++i)
+            mesh.positions[i] += velocities[i];
+    };
+
+    for (int frame = 1; frame <= frames; ++frame)
+    {
+        advance(refit);
+        advance(rebuilt);
+        advance(adaptive);
+        bool rebuild = false;
+        double refit_s = time_seconds([&] { refit.refit(std::numeric_limits<double>::infinity()); });
+        double rebuild_s = time_seconds([&] { rebuilt.build(); });
+        double adaptive_s = time_seconds([&] { rebuild = adaptive.refit(1.5); });
+        double refit_trace = time_seconds([&] { trace_closest(refit, rays); });
+        double rebuilt_trace = time_seconds([&] { trace_closest(rebuilt, rays); });
+        std::cout << "  frame " << frame << ": refit " << refit_s * 1000 << " ms (SAH x" << std::setprecision(3)
+                  << refit.bvh.quality_ratio() << ", trace " << refit_trace * 1000 << " ms), rebuild " << rebuild_s * 1000
+                  << " ms (trace " << rebuilt_trace * 1000 << " ms), adaptive " << adaptive_s * 1000 << " ms"
+                  << (rebuild ? " [rebuilt]" : "") << std::setprecision(6) << "\n";
+    }
+}
+
+size_t mesh_bytes(const TriangleMesh &mesh)
+{
+    return mesh.positions.size() * sizeof(Vec3) + mesh.indices.size() * sizeof(uint32_t) +
+           mesh.bvh.nodes.size() * sizeof(LinearBVHNode) + mesh.bvh.indices.size() * sizeof(uint32_t);
+}
+
+// A 10k triangle mesh placed many times with random rotations, as instances
+// over one shared mesh BVH vs. baked into a single mesh with all copies
+void bench_instances()
+{
+    const size_t mesh_triangles = 10000;
+    std::vector<Ray> rays = soup_rays(100000);
+    std::vector<shared_ptr<Hittable>> soup = make_triangle_soup(mesh_triangles, 0.1f);
+    std::vector<Vec3> positions;
+    std::vector<uint32_t> indices;
+    for (const auto &object : soup)
+    {
+        auto triangle = std::static_pointer_cast<Triangle>(object);
+        for (const Vec3 &p : {triangle->v1, triangle->v2, triangle->v3})
+        {
+            indices.push_back(static_cast<uint32_t>(positions.size()));
+            positions.push_back(p);
+        }
+    }
+    auto material = std::static_pointer_cast<Triangle>(soup[0])->mat_ptr;
+    auto mesh = make_shared<TriangleMesh>(positions, indices, material);
+    std::cout << "instanced mesh (" << mesh_triangles << " triangles, " << rays.size() << " rays)\n";
+
+    for (size_t count : {10, 100, 1000, 10000})
+    {
+        seed_thread_rng(23, 0);
+        std::vector<Transform> placements;
+        for (size_t i = 0; i < count; ++i)
+        {
+            float s = static_cast<float>(0.5 / std::cbrt(double(count)));
+            placements.push_back(Transform::translate(Vec3::random(-1, 1)) *
+                                 Transform::rotate(Vec3::random(-1, 1), random_double(0, 360)) *
+                                 Transform::scale(Vec3(s, s, s)));
+        }
+
+        std::vector<shared_ptr<Hittable>> instances;
+        for (const Transform &placement : placements)
+            instances.push_back(make_shared<Instance>(mesh, placement));
+        shared_ptr<LinearBVH> top;
+        size_t hits = 0;
+        double build = time_seconds([&] { top = make_shared<LinearBVH>(instances); });
+        double trace = time_seconds([&] { hits = trace_closest(*top, rays); });
+        report(std::to_string(count) + " instances", build, trace, rays.size(), hits);
+        size_t instance_bytes = mesh_bytes(*mesh) + count * (sizeof(Instance) + 16 + 2 * sizeof(shared_ptr<Hittable>)) +
+                                top->tree.nodes.size() * sizeof(LinearBVHNode);
+        std::cout << "  memory: " << instance_bytes / 1024 << " KiB\n";
+
+        if (count * mesh_triangles > 1000000)
+            continue;
+        std::vector<Vec3> baked_positions;
+        std::vector<uint32_t> baked_indices;
+        baked_positions.reserve(count * positions.size());
+        for (const Transform &placement : placements)
+        {
+            for (uint32_t index : indices)
+                baked_indices.push_back(static_cast<uint32_t>(baked_positions.size() + index));
+            for (const Vec3 &p : positions)
+                baked_positions.push_back(placement.point(p));
+        }
+        shared_ptr<TriangleMesh> baked;
+        build = time_seconds([&] { baked = make_shared<TriangleMesh>(std::move(baked_positions), std::move(baked_indices), material); });
+        trace = time_seconds([&] { hits = trace_closest(*baked, rays); });
+        report("  baked copies", build, trace, rays.size(), hits);
+        std::cout << "  memory: " << mesh_bytes(*baked) / 1024 << " KiB\n";
+    }
+}
+
+// 100k spheres as separate Sphere objects under a LinearBVH vs. one SphereSet
+// at each SIMD width the CPU supports
+void bench_spheres()
+{
+    const size_t count = 100000;
+    std::vector<shared_ptr<Hittable>> objects = make_spheres(count);
+    std::vector<Ray> rays = soup_rays(200000);
+    std::cout << "spheres (" << count << " spheres, " << rays.size() << " rays)\n";
+
+    shared_ptr<LinearBVH> bvh;
+    size_t hits = 0;
+    double build = time_seconds([&] { bvh = make_shared<LinearBVH>(objects); });
+    double trace = time_seconds([&] { hits = trace_closest(*bvh, rays); });
+    report("Sphere objects", build, trace, rays.size(), hits);
+
+    std::vector<shared_ptr<Sphere>> spheres;
+    for (const auto &object : objects)
+        spheres.push_back(std::static_pointer_cast<Sphere>(object));
+    for (int width : {1, 4, 8, 16})
+    {
+        shared_ptr<SphereSet> set;
+        build = time_seconds([&] { set = make_shared<SphereSet>(spheres, width); });
+        if (set->lanes != width)
+            continue;
+        trace = time_seconds([&] { hits = trace_closest(*set, rays); });
+        report("SphereSet, " + std::to_string(width) + (width == 1 ? " lane" : " lanes"), build, trace, rays.size(), hits);
+    }
+}
+
+// A BVHNode chain 1000 levels deep, as degenerate splits can produce, flattened
+// and traced; the traversal stack must grow past its fixed 64 entries
+void bench_deep()
+{
+    const int levels = 1000;
+    auto material = std::static_pointer_cast<Material>(make_shared<Diffuse>(Vec3(0.5, 0.5, 0.5)));
+    std::vector<shared_ptr<Hittable>> spheres;
+    for (int i = 0; i <= levels; ++i)
+        spheres.push_back(make_shared<Sphere>(Vec3(float(i), 0, 0), 0.25f, material));
+
+    // Each node holds the rest of the chain on the left and one sphere on the
+    // right; rays along +x visit the left child first and keep every right one
+    // pending, so the stack holds one entry per level
+    shared_ptr<Hittable> chain = spheres[levels];
+    for (int i = levels - 1; i >= 0; --i)
+    {
+        auto node = make_shared<BVHNode>();
+        node->left = chain;
+        node->right = spheres[i];
+        aabb left_box, right_box;
+        chain->bounding_box(0, 0, left_box);
+        spheres[i]->bounding_box(0, 0, right_box);
+        node->box = surrounding_box(left_box, right_box);
+        chain = node;
+    }
+
+    std::vector<Ray> rays;
+    for (int i = 0; i <= levels; ++i)
+    {
+        rays.emplace_back(Vec3(float(i), 1, 0), Vec3(0, -1, 0));
+        rays.emplace_back(Vec3(-1, 0, 0), Vec3(1, 0, 0));
+    }
+    LinearBVH flat(*std::static_pointer_cast<BVHNode>(chain));
+    size_t hits = 0;
+    double trace = time_seconds([&] { hits = trace_closest(flat, rays); });
+    hittable_list list;
+    list.objects = spheres;
+    std::cout << "deep chain (" << levels << " levels, tree depth " << flat.tree.depth << ")\n";
+    report("flattened BVHNode", 0, trace, rays.size(), hits);
+    std::cout << "  list: " << trace_closest(list, rays) << " hits\n";
+}
+
+// A scene ready for the integrators, at a reduced resolution
+struct RenderScene
+{
+    Camera camera;
+    hittable_list world;
+    std::vector<Light> lights;
+    std::vector<Emitter> emitters;
+    Color background;
+    shared_ptr<LinearBVH> bvh;
+};
+
+json read_json(const std::string &path)
+{
+    std::ifstream file(path);
+    json j;
+    file >> j;
+    return j;
+}
+
+RenderScene load_render_scene(json j, const std::string &path, int width, int height)
+{
+    j["camera"]["width"] = width;
+    j["camera"]["height"] = height;
+
+    RenderScene scene;
+    scene.camera = parseCamera(j);
+    parseScene(j, scene.world, std::filesystem::path(path).parent_path().string());
+    parseLights(j, scene.lights);
+    scene.emitters = collect_emitters(scene.world.objects);
+    scene.background = j["scene"].contains("backgroundcolor") ? Color(j["scene"]["backgroundcolor"]) : Color(0.25, 0.25, 0.25);
+    scene.bvh = make_shared<LinearBVH>(scene.world.objects);
+    return scene;
+}
+
+// Path traced (brdf integrator) image at the given spp
+std::vector<Color> render_image(const RenderScene &scene, const std::vector<Emitter> &emitters, SamplerType sampler,
+                                int spp, uint64_t seed)
+{
+    const Camera &camera = scene.camera;
+    SampleContext ctx{camera, *scene.bvh, scene.lights, emitters, scene.background, camera.width, camera.height, 10, 5, sampler, seed};
+    Film film(camera.width, camera.height, seed);
+    TileScheduler scheduler(camera.width, camera.height, 16);
+    run_tiles(scheduler, default_thread_count(), [&](const Tile &tile)
+              { render_tile(tile, film, ctx, spp); });
+    return film.resolve();
+}
+
+double rmse(const std::vector<Color> &image, const std::vector<Color> &reference)
+{
+    double error = 0;
+    for (size_t i = 0; i < image.size(); ++i)
+    {
+        Color d = image[i] - reference[i];
+        error += d.x * d.x + d.y * d.y + d.z * d.z;
+    }
+    return std::sqrt(error / (3 * image.size()));
+}
+
+// Convergence of the samplers on the emissive scene at 200x150: RMSE of the
+// path traced image against a 1024 spp Sobol reference at 1 to 64 spp
+void bench_samplers()
+{
+    std::string scene_path = "../json_list/With_emmision.json";
+    RenderScene scene = load_render_scene(read_json(scene_path), scene_path, 200, 150);
+    std::vector<Color> reference;
+    double reference_time = time_seconds([&] { reference = render_image(scene, scene.emitters, SamplerType::Sobol, 1024, 99); });
+    std::cout << "samplers (" << scene_path << " at 200x150, reference 1024 spp in " << reference_time << " s)\n";
+    std::cout << "  spp      random       sobol   bluenoise\n";
+    for (int spp = 1; spp <= 64; spp *= 2)
+    {
+        std::cout << "  " << std::setw(3) << spp;
+        for (SamplerType sampler : {SamplerType::Random, SamplerType::Sobol, SamplerType::BlueNoise})
+            std::cout << std::setw(12) << rmse(render_image(scene, scene.emitters, sampler, spp, 1), reference);
+        std::cout << "\n";
+    }
+}
+
+// Next-event estimation at 160x120: RMSE against a 2048 spp reference with
+// only BSDF sampling and with emitter sampling plus MIS. With_emmision.json has
+// large dim emitters and a grey background; the second scene is Custom.json
+// lit only by its emissive sphere, shrunk to radius 0.1 and made 25x brighter.
+void bench_nee()
+{
+    json small_emitter = read_json("../json_list/Custom.json");
+    small_emitter["scene"]["backgroundcolor"] = {0, 0, 0};
+    small_emitter["scene"]["lightsources"] = json::array();
+    for (json &shape : small_emitter["scene"]["shapes"])
+    {
+        if (shape["material"].contains("emissioncolor"))
+        {
+            shape["radius"] = 0.1;
+            for (json &channel : shape["material"]["emissioncolor"])
+                channel = channel.get<float>() * 25;
+        }
+    }
+
+    std::vector<std::pair<std::string, json>> scenes = {
+        {"../json_list/With_emmision.json", read_json("../json_list/With_emmision.json")},
+        {"../json_list/Custom.json, small emitter", small_emitter}};
+    for (const auto &[name, j] : scenes)
+    {
+        RenderScene scene = load_render_scene(j, "../json_list/", 160, 120);
+        std::vector<Color> reference;
+        double reference_time = time_seconds([&] { reference = render_image(scene, scene.emitters, SamplerType::Random, 2048, 99); });
+        std::cout << "next-event estimation (" << name << ", " << scene.emitters.size()
+                  << " emitters, reference in " << reference_time << " s)\n";
+        std::cout << "  spp        bsdf    bsdf+nee\n";
+        for (int spp = 1; spp <= 256; spp *= 4)
+        {
+            std::vector<Color> bsdf, nee;
+            double bsdf_time = time_seconds([&] { bsdf = render_image(scene, {}, SamplerType::Random, spp, 1); });
+            double nee_time = time_seconds([&] { nee = render_image(scene, scene.emitters, SamplerType::Random, spp, 1); });
+            std::cout << "  " << std::setw(3) << spp << std::setw(12) << rmse(bsdf, reference) << std::setw(12)
+                      << rmse(nee, reference) << "   (" << bsdf_time * 1000 << " / " << nee_time * 1000 << " ms)\n";
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string name = argc > 1 ? argv[1] : "all";
+    std::string scene_path = argc > 2 ? argv[2] : "../json_list/Custom.json";
+
+    if (name == "linear" || name == "all")
+        bench_linear(scene_path);
+    if (name == "wide" || name == "all")
+        bench_wide(scene_path);
+    if (name == "threads" || name == "all")
+        bench_threads(scene_path);
+    if (name == "bounds" || name == "all")
+        bench_bounds();
+    if (name == "mesh" || name == "all")
+        bench_mesh();
+    if (name == "build" || name == "all")
+        bench_build();
+    if (name == "lbvh" || name == "all")
+        bench_lbvh();
+    if (name == "scaling" || name == "all")
+        bench_scaling();
+    if (name == "load" || name == "all")
+        bench_load();
+    if (name == "refit" || name == "all")
+        bench_refit();
+    if (name == "instances" || name == "all")
+        bench_instances();
+    if (name == "spheres" || name == "all")
+        bench_spheres();
+    if (name == "deep" || name == "all")
+        bench_deep();
+    if (name == "samplers" || name == "all")
+        bench_samplers();
+    if (name == "nee" || name == "all")
+        bench_nee();
+    return 0;
+}
@@ -55,7 +55,7 @@ public:
                 rec.t = t;
                 rec.p = hit_point;
                 rec.normal = ((hit_point - base_center) - axis * projection).normalized();
-                rec.mat_ptr = mat_ptr;
+                rec.mat_ptr = mat_ptr.get();
                 return true;
             }
         }
@@ -108,7 +108,7 @@ public:
                 rec.t = t;
                 rec.p = point;
                 rec.normal = is_top ? axis : -axis; // Normal points outwards from the cap
-                rec.mat_ptr = mat_ptr;
+                rec.mat_ptr = mat_ptr.get();
                 return true;
             }
         }
@@ -0,0 +1,125 @@
+#pragma once
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "Sphere.hpp"
+#include "Triangle.hpp"
+
+// Emissive sphere or triangle that path_tracer_BRDF samples directly. Spheres
+// are sampled uniformly in the cone they subtend, triangles uniformly by area;
+// both report the pdf per unit solid angle so it can be compared with the
+// BSDF's pdf in the MIS weights.
+struct Emitter
+{
+    std::shared_ptr<Sphere> sphere;     // set for spherical emitters
+    std::shared_ptr<Triangle> triangle; // set for triangular emitters
+
+    const Material *material() const { return sphere ? sphere->mat_ptr.get() : triangle->mat_ptr.get(); }
+
+    // Unit direction from p towards a point on the emitter, the distance to
+    // that point and the solid angle pdf; false when p sees no sample
+    bool sample(const Vec3 &p, Vec3 &direction, double &distance, double &pdf) const
+    {
+        if (sphere)
+        {
+            Vec3 to_center = sphere->center - p;
+            double center_sq = to_center.length_squared();
+            double radius_sq = double(sphere->radius) * sphere->radius;
+            if (center_sq <= radius_sq)
+                return false;
+
+            double cos_max = std::sqrt(1 - radius_sq / center_sq);
+            double cos_theta = 1 - sample_1d() * (1 - cos_max);
+            double sin_theta = std::sqrt(std::max(0.0, 1 - cos_theta * cos_theta));
+            double phi = 2 * pi * sample_1d();
+            Vec3 w = to_center / std::sqrt(center_sq);
+            Vec3 u = (std::fabs(w.x) > 0.9f ? Vec3(0, 1, 0) : Vec3(1, 0, 0)).cross(w).normalized();
+            Vec3 v = w.cross(u);
+            direction = (u * std::cos(phi) * sin_theta + v * std::sin(phi) * sin_theta + w * cos_theta).normalized();
+
+            // Nearest root along the sampled direction; a grazing sample that
+            // misses through round-off takes the tangent point
+            double half_b = -to_center.dot(direction);
+            double discriminant = half_b * half_b - (center_sq - radius_sq);
+            distance = -half_b - std::sqrt(std::max(0.0, discriminant));
+            pdf = cone_pdf(cos_max);
+            return distance > 0;
+        }
+
+        double su = std::sqrt(sample_1d()), b = sample_1d() * su;
+        Vec3 q = triangle->v1 * (1 - su) + triangle->v2 * b + triangle->v3 * (su - b);
+        Vec3 to_point = q - p;
+        distance = to_point.length();
+        if (distance <= 0)
+            return false;
+        direction = to_point / distance;
+        pdf = area_pdf(direction, distance);
+        return pdf > 0;
+    }
+
+    // Solid angle pdf of sample() for a ray from p in the unit direction that
+    // reaches the emitter at the given distance
+    double pdf(const Vec3 &p, const Vec3 &direction, double distance) const
+    {
+        if (sphere)
+        {
+            double center_sq = (sphere->center - p).length_squared();
+            double radius_sq = double(sphere->radius) * sphere->radius;
+            return center_sq <= radius_sq ? 0 : cone_pdf(std::sqrt(1 - radius_sq / center_sq));
+        }
+        return area_pdf(direction, distance);
+    }
+
+    // Distance along the ray to the emitter, if it is hit within [t_min, t_max]
+    bool intersect(const Ray &r, double t_min, double t_max, double &t) const
+    {
+        if (triangle)
+            return triangle->intersect(r, t_min, t_max, t);
+        Hit_record rec;
+        if (!sphere->hit(r, t_min, t_max, rec))
+            return false;
+        t = rec.t;
+        return true;
+    }
+
+private:
+    static double cone_pdf(double cos_max) { return 1 / (2 * pi * (1 - cos_max)); }
+
+    // Area pdf 1 / A converted to solid angle; triangles emit from both sides
+    double area_pdf(const Vec3 &direction, double distance) const
+    {
+        Vec3 n = (triangle->v2 - triangle->v1).cross(triangle->v3 - triangle->v1);
+        double twice_area = n.length();
+        double cos_light = std::fabs(n.dot(direction)) / twice_area;
+        if (twice_area <= 0 || cos_light < 1e-6)
+            return 0;
+        return distance * distance / (cos_light * 0.5 * twice_area);
+    }
+};
+
+// Emissive spheres and triangles among the scene's objects. Emissive meshes,
+// cylinders and instances are not sampled and only contribute when a bounce
+// hits them.
+inline std::vector<Emitter> collect_emitters(const std::vector<std::shared_ptr<Hittable>> &objects)
+{
+    std::vector<Emitter> emitters;
+    auto emissive = [](const std::shared_ptr<Material> &m)
+    {
+        Color e = m->emit();
+        return e.x > 0 || e.y > 0 || e.z > 0;
+    };
+    for (const auto &object : objects)
+    {
+        if (auto sphere = std::dynamic_pointer_cast<Sphere>(object))
+        {
+            if (emissive(sphere->mat_ptr))
+                emitters.push_back({sphere, nullptr});
+        }
+        else if (auto triangle = std::dynamic_pointer_cast<Triangle>(object))
+        {
+            if (emissive(triangle->mat_ptr))
+                emitters.push_back({nullptr, triangle});
+        }
+    }
+    return emitters;
+}
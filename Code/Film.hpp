@@ -0,0 +1,132 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "utility.hpp"
+#include "ImageOutput.hpp"
+
+inline float luminance(const Color &c)
+{
+    return 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+}
+
+// Per-pixel accumulation state: radiance sum, sample count, the sum of
+// squared luminance for variance estimates and the pixel's own random
+// generator. A pixel draws from its generator wherever and however often it
+// is sampled, so the image depends only on the seed and the samples per pixel.
+struct Film
+{
+    int width = 0, height = 0;
+    std::vector<Color> sum;
+    std::vector<float> luminance_sq;
+    std::vector<uint32_t> samples;
+    std::vector<Pcg32> rng;
+
+    Film() {}
+
+    Film(int width, int height, uint64_t seed)
+        : width(width), height(height), sum(pixel_count()), luminance_sq(pixel_count()), samples(pixel_count()),
+          rng(pixel_count())
+    {
+        for (size_t i = 0; i < rng.size(); ++i)
+            rng[i].seed(seed, i);
+    }
+
+    size_t pixel_count() const { return static_cast<size_t>(width) * height; }
+
+    void add(size_t i, const Color &c)
+    {
+        sum[i] += c;
+        float l = luminance(c);
+        luminance_sq[i] += l * l;
+        samples[i]++;
+    }
+
+    Color mean(size_t i) const { return samples[i] ? sum[i] / static_cast<float>(samples[i]) : Color(0, 0, 0); }
+
+    // Standard error of the mean luminance relative to the mean itself
+    double relative_error(size_t i) const
+    {
+        uint32_t n = samples[i];
+        if (n < 2)
+            return inf;
+        double mean_l = luminance(sum[i]) / n;
+        double variance = std::max(0.0, (luminance_sq[i] - n * mean_l * mean_l) / (n - 1));
+        return std::sqrt(variance / n) / std::max(mean_l, 1e-3);
+    }
+
+    // Average radiance per pixel, ready for tone mapping with one sample per pixel
+    std::vector<Color> resolve() const
+    {
+        std::vector<Color> out(pixel_count());
+        for (size_t i = 0; i < out.size(); ++i)
+            out[i] = mean(i);
+        return out;
+    }
+
+    uint64_t total_samples() const
+    {
+        uint64_t total = 0;
+        for (uint32_t n : samples)
+            total += n;
+        return total;
+    }
+};
+
+// Checkpoint header. The render settings that change the per-pixel random
+// sequences are stored so a resume with different ones is refused.
+struct CheckpointHeader
+{
+    char magic[4] = {'R', 'T', 'C', 'K'};
+    uint32_t version = 2;
+    int32_t width = 0, height = 0;
+    uint64_t seed = 0;
+    int32_t integrator = 0, max_depth = 0;
+    int32_t sampler = 0; // SamplerType
+    int32_t padding = 0;
+};
+
+// Binary checkpoint in native byte order: the header, then the radiance sums,
+// squared luminance sums, sample counts and generator states of all pixels
+inline bool save_checkpoint(const std::string &path, const Film &film, const CheckpointHeader &header)
+{
+    std::string data;
+    auto append = [&](const void *bytes, size_t size)
+    { data.append(static_cast<const char *>(bytes), size); };
+    size_t n = film.pixel_count();
+    data.reserve(sizeof(header) + n * (sizeof(Color) + sizeof(float) + sizeof(uint32_t) + sizeof(Pcg32)));
+    append(film.sum.data(), n * sizeof(Color));
+    append(film.luminance_sq.data(), n * sizeof(float));
+    append(film.samples.data(), n * sizeof(uint32_t));
+    append(film.rng.data(), n * sizeof(Pcg32));
+    return write_file(path, std::string(reinterpret_cast<const char *>(&header), sizeof(header)), data.data(), data.size());
+}
+
+inline bool load_checkpoint(const std::string &path, Film &film, CheckpointHeader &header, std::string &error)
+{
+    std::ifstream in(path, std::ios::binary);
+    CheckpointHeader expected;
+    if (!in || !in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+        header.width <= 0 || header.height <= 0)
+    {
+        error = "'" + path + "' is not a checkpoint";
+        return false;
+    }
+
+    film = Film(header.width, header.height, header.seed);
+    size_t n = film.pixel_count();
+    in.read(reinterpret_cast<char *>(film.sum.data()), n * sizeof(Color));
+    in.read(reinterpret_cast<char *>(film.luminance_sq.data()), n * sizeof(float));
+    in.read(reinterpret_cast<char *>(film.samples.data()), n * sizeof(uint32_t));
+    in.read(reinterpret_cast<char *>(film.rng.data()), n * sizeof(Pcg32));
+    if (!in)
+    {
+        error = "checkpoint '" + path + "' is truncated";
+        return false;
+    }
+    return true;
+}
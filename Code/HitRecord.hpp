@@ -20,6 +20,7 @@ public:
 
     virtual bool hit(const Ray &r, double tmin, double tmax, Hit_record &rec) const;
     virtual bool bounding_box(double t0, double t1, aabb &output_box) const;
+    virtual bool occluded(const Ray &r, double t_min, double t_max) const;
 };
 
 bool hittable_list::hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const
@@ -40,6 +41,16 @@ bool hittable_list::hit(const Ray &r, double t_min, double t_max, Hit_record &re
     return hit_anything;
 }
 
+bool hittable_list::occluded(const Ray &r, double t_min, double t_max) const
+{
+    for (const auto &object : objects)
+    {
+        if (object->occluded(r, t_min, t_max))
+            return true;
+    }
+    return false;
+}
+
 bool hittable_list::bounding_box(double t0, double t1, aabb &output_box) const
 {
     if (objects.empty())
@@ -8,8 +8,9 @@ class Hit_record
 public:
   Vec3 p;
   Vec3 normal;
-  shared_ptr<Material> mat_ptr;
+  const Material *mat_ptr = nullptr; // owned by the primitive, no refcount traffic on the hit path
   double t;
+  float u = 0, v = 0; // surface coordinates, set by primitives that have them
   bool front_face;
 
   inline void set_face_normal(const Ray &r, const Vec3 &outward_normal)
@@ -25,6 +26,14 @@ public:
   virtual bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const = 0;
   virtual bool bounding_box(double t0, double t1, aabb &output_box) const = 0;
 
+  // Any-hit query for shadow rays: true as soon as anything blocks the segment
+  // [t_min, t_max]. Override when a cheaper test than a full hit() exists.
+  virtual bool occluded(const Ray &r, double t_min, double t_max) const
+  {
+    Hit_record rec;
+    return hit(r, t_min, t_max, rec);
+  }
+
 public:
   Vec3 center = Vec3(0, 0, 0);
 };
\ No newline at end of file
@@ -0,0 +1,250 @@
+#pragma once
+#include <cstdint>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utility.hpp"
+#include "TileScheduler.hpp"
+
+using Color = Vec3;
+
+Color linearToneMapping(const Color &color, float exposure)
+{
+    Color mapped = color * exposure; // Scale based on exposure
+
+    return Color(
+        fmin(mapped.x, 1.0f),
+        fmin(mapped.y, 1.0f),
+        fmin(mapped.z, 1.0f));
+}
+
+Color reinhardToneMapping(const Color &color, float exposure)
+{
+    Color mapped = color * exposure; // Scale based on exposure
+
+    return Color(
+        mapped.x / (1.0f + mapped.x),
+        mapped.y / (1.0f + mapped.y),
+        mapped.z / (1.0f + mapped.z));
+}
+
+using ToneMapping = Color (*)(const Color &, float);
+
+inline uint8_t to_byte(double c)
+{
+    return static_cast<uint8_t>(256 * clamp(c, 0.0, 0.999));
+}
+
+// 8-bit RGB images produced from the accumulated framebuffer in one pass:
+// gamma is tone mapped and gamma corrected, normal only averaged and sqrt'ed
+struct ToneMappedImages
+{
+    std::vector<uint8_t> gamma;
+    std::vector<uint8_t> normal;
+};
+
+// Convert the framebuffer to both 8-bit images, splitting the rows across
+// num_threads workers. An image is skipped when its flag is false.
+inline ToneMappedImages tone_map(const std::vector<Color> &framebuffer, int width, int height, int samples_per_pixel,
+                                 float exposure, ToneMapping tone_mapping, bool want_gamma, bool want_normal,
+                                 int num_threads)
+{
+    ToneMappedImages images;
+    if (want_gamma)
+        images.gamma.resize(framebuffer.size() * 3);
+    if (want_normal)
+        images.normal.resize(framebuffer.size() * 3);
+    if (!want_gamma && !want_normal)
+        return images;
+
+    const float gamma_correction = 1.0f / 2.2f;
+    const double scale = 1.0 / samples_per_pixel;
+    uint8_t *gamma = want_gamma ? images.gamma.data() : nullptr;
+    uint8_t *normal = want_normal ? images.normal.data() : nullptr;
+
+    TileScheduler rows(width, height, 16);
+    run_tiles(rows, num_threads, [&](const Tile &tile)
+              {
+        for (int y = tile.y0; y < tile.y1; ++y)
+        {
+            for (int x = tile.x0; x < tile.x1; ++x)
+            {
+                size_t i = static_cast<size_t>(y) * width + x;
+                const Color &c = framebuffer[i];
+                if (gamma)
+                {
+                    Color mapped = tone_mapping(c / samples_per_pixel, exposure);
+                    gamma[3 * i + 0] = to_byte(pow(mapped.x, gamma_correction));
+                    gamma[3 * i + 1] = to_byte(pow(mapped.y, gamma_correction));
+                    gamma[3 * i + 2] = to_byte(pow(mapped.z, gamma_correction));
+                }
+                if (normal)
+                {
+                    normal[3 * i + 0] = to_byte(sqrt(scale * c.x));
+                    normal[3 * i + 1] = to_byte(sqrt(scale * c.y));
+                    normal[3 * i + 2] = to_byte(sqrt(scale * c.z));
+                }
+            }
+        } });
+    return images;
+}
+
+// Per-pixel sample counts as an 8-bit RGB heatmap from blue (few) through
+// green to red (max_samples)
+inline std::vector<uint8_t> sample_heatmap(const std::vector<uint32_t> &samples, uint32_t max_samples)
+{
+    std::vector<uint8_t> rgb(samples.size() * 3);
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        double f = clamp(double(samples[i]) / std::max(max_samples, 1u), 0.0, 1.0);
+        rgb[3 * i + 0] = to_byte(clamp(2 * f - 1, 0.0, 1.0));
+        rgb[3 * i + 1] = to_byte(1 - std::abs(2 * f - 1));
+        rgb[3 * i + 2] = to_byte(clamp(1 - 2 * f, 0.0, 1.0));
+    }
+    return rgb;
+}
+
+// Write the whole file with a single write call. The data goes to a temporary
+// file that is then renamed over path, so snapshots rewritten during a render
+// are never seen half written.
+inline bool write_file(const std::string &path, const std::string &header, const char *data, size_t size)
+{
+    std::string contents;
+    contents.reserve(header.size() + size);
+    contents.append(header);
+    contents.append(data, size);
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary);
+        if (!out)
+            return false;
+        out.write(contents.data(), contents.size());
+        if (!out)
+            return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    return !error;
+}
+
+// Runs write(snapshot) on its own thread so render threads never wait for
+// tone mapping or disk. Only the newest pending snapshot is kept: one submitted
+// while the writer is busy replaces any older one that has not started yet.
+template <typename Snapshot>
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(std::function<void(const Snapshot &)> write)
+        : write(std::move(write)), worker([this]
+                                          { run(); }) {}
+
+    ~SnapshotWriter() { finish(); }
+
+    void submit(Snapshot snapshot)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = std::move(snapshot);
+            has_pending = true;
+        }
+        wake.notify_one();
+    }
+
+    // Write what is still pending and stop the thread
+    void finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        wake.notify_one();
+        if (worker.joinable())
+            worker.join();
+    }
+
+private:
+    std::function<void(const Snapshot &)> write;
+    std::mutex mutex;
+    std::condition_variable wake;
+    Snapshot pending;
+    bool has_pending = false;
+    bool done = false;
+    std::thread worker; // last, so it starts after the members above exist
+
+    void run()
+    {
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]
+                      { return has_pending || done; });
+            if (!has_pending)
+                return;
+            Snapshot snapshot = std::move(pending);
+            has_pending = false;
+            lock.unlock();
+            write(snapshot);
+        }
+    }
+};
+
+// 8-bit RGB image as binary P6 or ASCII P3
+inline bool write_ppm(const std::string &path, int width, int height, const std::vector<uint8_t> &rgb, bool binary)
+{
+    std::string header = std::string(binary ? "P6\n" : "P3\n") + std::to_string(width) + ' ' + std::to_string(height) + "\n255\n";
+    if (binary)
+        return write_file(path, header, reinterpret_cast<const char *>(rgb.data()), rgb.size());
+
+    // Format through a table of the 256 possible values instead of per-channel stream output
+    static const std::vector<std::string> digits = []
+    {
+        std::vector<std::string> table(256);
+        for (int v = 0; v < 256; ++v)
+            table[v] = std::to_string(v);
+        return table;
+    }();
+    std::string text;
+    text.reserve(rgb.size() * 4);
+    for (size_t i = 0; i < rgb.size(); i += 3)
+    {
+        text += digits[rgb[i]];
+        text += ' ';
+        text += digits[rgb[i + 1]];
+        text += ' ';
+        text += digits[rgb[i + 2]];
+        text += '\n';
+    }
+    return write_file(path, header, text.data(), text.size());
+}
+
+// Float RGB radiance averaged over the samples, without tone mapping or
+// exposure. PFM stores rows bottom to top; the negative scale marks little endian.
+inline bool write_pfm(const std::string &path, int width, int height, const std::vector<Color> &framebuffer,
+                      int samples_per_pixel)
+{
+    std::vector<float> data(framebuffer.size() * 3);
+    const float scale = 1.0f / samples_per_pixel;
+    for (int y = 0; y < height; ++y)
+    {
+        const Color *src = &framebuffer[static_cast<size_t>(y) * width];
+        float *dst = &data[static_cast<size_t>(height - 1 - y) * width * 3];
+        for (int x = 0; x < width; ++x)
+        {
+            dst[3 * x + 0] = src[x].x * scale;
+            dst[3 * x + 1] = src[x].y * scale;
+            dst[3 * x + 2] = src[x].z * scale;
+        }
+    }
+
+    uint16_t probe = 1;
+    bool little_endian = *reinterpret_cast<uint8_t *>(&probe) == 1;
+    std::string header = "PF\n" + std::to_string(width) + ' ' + std::to_string(height) + (little_endian ? "\n-1.0\n" : "\n1.0\n");
+    return write_file(path, header, reinterpret_cast<const char *>(data.data()), data.size() * sizeof(float));
+}
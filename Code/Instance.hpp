@@ -0,0 +1,161 @@
+#pragma once
+#include <cmath>
+#include <memory>
+#include "Hitable.hpp"
+
+// Affine transform stored as a 3x3 linear part plus a translation
+struct Transform
+{
+    float m[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    Vec3 t = Vec3(0, 0, 0);
+
+    static Transform translate(const Vec3 &offset)
+    {
+        Transform x;
+        x.t = offset;
+        return x;
+    }
+
+    static Transform scale(const Vec3 &s)
+    {
+        Transform x;
+        x.m[0][0] = s.x;
+        x.m[1][1] = s.y;
+        x.m[2][2] = s.z;
+        return x;
+    }
+
+    // Rotation by the given angle in degrees around a unit axis (Rodrigues)
+    static Transform rotate(const Vec3 &axis, double degrees)
+    {
+        double theta = degrees_to_radians(degrees);
+        float c = static_cast<float>(std::cos(theta)), s = static_cast<float>(std::sin(theta)), k = 1 - c;
+        Vec3 a = axis.normalized();
+        Transform x;
+        x.m[0][0] = c + a.x * a.x * k;
+        x.m[0][1] = a.x * a.y * k - a.z * s;
+        x.m[0][2] = a.x * a.z * k + a.y * s;
+        x.m[1][0] = a.y * a.x * k + a.z * s;
+        x.m[1][1] = c + a.y * a.y * k;
+        x.m[1][2] = a.y * a.z * k - a.x * s;
+        x.m[2][0] = a.z * a.x * k - a.y * s;
+        x.m[2][1] = a.z * a.y * k + a.x * s;
+        x.m[2][2] = c + a.z * a.z * k;
+        return x;
+    }
+
+    // this * other: applies other first
+    Transform operator*(const Transform &other) const
+    {
+        Transform x;
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int c = 0; c < 3; ++c)
+                x.m[r][c] = m[r][0] * other.m[0][c] + m[r][1] * other.m[1][c] + m[r][2] * other.m[2][c];
+        }
+        x.t = point(other.t);
+        return x;
+    }
+
+    Vec3 vector(const Vec3 &v) const
+    {
+        return Vec3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                    m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                    m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+    }
+
+    Vec3 point(const Vec3 &p) const { return vector(p) + t; }
+
+    // Multiply by the transposed linear part; with the inverse transform this
+    // maps object space normals to world space
+    Vec3 transposed_vector(const Vec3 &v) const
+    {
+        return Vec3(m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z,
+                    m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z,
+                    m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z);
+    }
+
+    Transform inverse() const
+    {
+        Transform x;
+        double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                     m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                     m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        float inv = static_cast<float>(1.0 / det);
+        x.m[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * inv;
+        x.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+        x.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+        x.m[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * inv;
+        x.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+        x.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+        x.m[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * inv;
+        x.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+        x.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+        x.t = -x.vector(t);
+        return x;
+    }
+};
+
+// A placed copy of shared geometry. The object (usually a TriangleMesh with
+// its own BVH) is the bottom level and is shared by every instance; the
+// instance only stores the transform, so memory grows with unique geometry.
+// Instances go into the world list like any other Hittable and the scene
+// BVH over them is the top level.
+class Instance : public Hittable
+{
+public:
+    std::shared_ptr<Hittable> object;
+    Transform to_world;
+    Transform to_object;
+    std::shared_ptr<Material> mat_ptr; // overrides the object's material when set
+
+    Instance(std::shared_ptr<Hittable> object, const Transform &to_world, std::shared_ptr<Material> m = nullptr)
+        : object(std::move(object)), to_world(to_world), to_object(to_world.inverse()), mat_ptr(std::move(m))
+    {
+        aabb box;
+        if (this->object->bounding_box(0, 0, box))
+            world_box = transform_box(box);
+        center = world_box.centroid();
+    }
+
+    // The object space direction is not renormalized, so t is the same in both spaces
+    bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const override
+    {
+        if (!object->hit(object_ray(r), t_min, t_max, rec))
+            return false;
+
+        rec.p = r.at(rec.t);
+        rec.normal = to_object.transposed_vector(rec.normal).normalized();
+        if (mat_ptr)
+            rec.mat_ptr = mat_ptr.get();
+        return true;
+    }
+
+    bool occluded(const Ray &r, double t_min, double t_max) const override
+    {
+        return object->occluded(object_ray(r), t_min, t_max);
+    }
+
+    bool bounding_box(double t0, double t1, aabb &output_box) const override
+    {
+        output_box = world_box;
+        return true;
+    }
+
+private:
+    aabb world_box = aabb::empty();
+
+    Ray object_ray(const Ray &r) const { return Ray(to_object.point(r.origin), to_object.vector(r.direction)); }
+
+    aabb transform_box(const aabb &box) const
+    {
+        aabb out = aabb::empty();
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            Vec3 p(corner & 1 ? box._max.x : box._min.x, corner & 2 ? box._max.y : box._min.y,
+                   corner & 4 ? box._max.z : box._min.z);
+            out = surrounding_box(out, to_world.point(p));
+        }
+        return out;
+    }
+};
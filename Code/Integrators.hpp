@@ -0,0 +1,412 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "Camera.hpp"
+#include "Hitable.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+#include "TileScheduler.hpp"
+#include "Film.hpp"
+#include "Emitter.hpp"
+
+// Integrators and the per-tile sampling loops shared by the renderer and the benchmarks
+
+Color Binary_Ray_Color(const Ray &r, const Hittable &world, const Color &background_color)
+{
+    Hit_record rec;
+    if (world.hit(r, 0.001, inf, rec))
+    {
+        Color lighting(1, 0, 0);
+        return lighting;
+    }
+
+    return background_color;
+}
+
+Color blinn_phong_shading(const Vec3 &view_dir, const Vec3 &light_dir, const Vec3 &normal, const Material &material, const Color &light_intensity)
+{
+    Color ambient = 0.1 * material.diffusecolor; // Adjust ambient factor as needed
+
+    float diff = std::max(0.0f, normal.dot(light_dir));
+    Color diffuse = diff * material.kd * material.diffusecolor * light_intensity;
+
+    Vec3 halfway_dir = (view_dir + light_dir).normalized();
+    float spec = std::pow(std::max(0.0f, normal.dot(halfway_dir)), material.specularexponent);
+    Color specular = spec * material.ks * material.specularcolor * light_intensity;
+
+    return ambient + diffuse + specular;
+}
+
+Color lerp(const Color &a, const Color &b, float t)
+{
+    return a * (1 - t) + b * t;
+}
+
+Color rayColor_Phong(const Ray &r, const Hittable &world, const std::vector<Light> &lights,
+                     const Color &background_color, int depth)
+{
+    if (depth <= 0)
+        return Color(0, 0, 0);
+
+    Hit_record rec;
+    if (world.hit(r, 0.001, inf, rec))
+    {
+        Color lighting(0, 0, 0); // Please change it to normalize the lighting for phong Shadding I am keeping it 0 0 0 to maximize the effect
+        Vec3 view_dir = -r.direction.normalized();
+
+        for (const auto &light : lights)
+        {
+            Vec3 light_dir = (light.position - rec.p).normalized();
+            Ray shadow_ray(rec.p, light_dir);
+            if (!world.occluded(shadow_ray, 0.001, (light.position - rec.p).length()))
+            {
+                lighting += blinn_phong_shading(view_dir, light_dir, rec.normal, *rec.mat_ptr, light.intensity);
+            }
+        }
+
+        if (rec.mat_ptr->isreflective && depth > 0)
+        {
+            Vec3 reflected_dir = reflect(r.direction.normalized(), rec.normal);
+            Ray reflected_ray(rec.p, reflected_dir);
+
+            float cos_theta = std::max(-reflected_dir.dot(rec.normal), 0.0f);
+            float fresnel = rec.mat_ptr->reflectivity + (1.0f - rec.mat_ptr->reflectivity) * std::pow(1.0f - cos_theta, 5);
+
+            Color reflected_color = rayColor_Phong(reflected_ray, world, lights, background_color, depth - 1);
+            lighting = lerp(lighting, reflected_color, fresnel);
+        }
+
+        return lighting;
+    }
+
+    return background_color;
+}
+
+Color rayColor(const Ray &r, const Hittable &world, const std::vector<Light> &lights,
+               const Color &background_color, int depth)
+{
+    if (depth <= 0)
+        return Color(0, 0, 0);
+
+    Hit_record rec;
+    if (world.hit(r, 0.001, inf, rec))
+    {
+        Color lighting(0, 0, 0);
+
+        for (const auto &light : lights)
+        {
+            Vec3 light_dir = (light.position - rec.p).normalized();
+            Ray shadow_ray(rec.p, light_dir);
+
+            if (!world.occluded(shadow_ray, 0.001, (light.position - rec.p).length()))
+            {
+                float diff = fmax(0.0, rec.normal.dot(light_dir));
+                Color diffuse = diff * rec.mat_ptr->kd * rec.mat_ptr->diffusecolor * light.intensity;
+
+                Vec3 view_dir = -r.direction.normalized();
+                Vec3 halfway_dir = (light_dir + view_dir).normalized();
+                float spec_angle = fmax(0.0, rec.normal.dot(halfway_dir));
+                float spec = pow(spec_angle, rec.mat_ptr->specularexponent);
+                Color specular = spec * rec.mat_ptr->ks * rec.mat_ptr->specularcolor * light.intensity;
+
+                lighting += diffuse + specular;
+            }
+        }
+
+        Color ambient(0.25, 0.25, 0.25);
+        lighting += ambient * rec.mat_ptr->diffusecolor;
+
+        if (rec.mat_ptr->isreflective && depth > 0)
+        {
+            Vec3 reflected_dir = reflect(r.direction.normalized(), rec.normal);
+            Ray reflected_ray(rec.p, reflected_dir);
+
+            float cos_theta = fmax(-reflected_dir.dot(rec.normal), 0.0);
+            float fresnel = rec.mat_ptr->reflectivity + (1.0 - rec.mat_ptr->reflectivity) * pow(1.0 - cos_theta, 5);
+
+            Color reflected_color = rayColor(reflected_ray, world, lights, background_color, depth - 1);
+
+            lighting = lerp(lighting, reflected_color, fresnel);
+        }
+
+        return lighting;
+    }
+
+    return background_color;
+}
+
+// Paths shorter than this are never terminated by Russian roulette
+const int russian_roulette_min_depth = 3;
+
+// Power heuristic (beta = 2) weight of the strategy with pdf a against the one with pdf b
+inline double power_heuristic(double a, double b)
+{
+    return a * a / (a * a + b * b);
+}
+
+// Diffuse is the only material with a non-delta BSDF; metal and glass bounces are treated as specular
+inline bool is_diffuse(const Material &m)
+{
+    return !m.isreflective && !m.isrefractive;
+}
+
+// Light from one sample of each emitter reflected by the diffuse surface at
+// rec, weighted against the chance of a diffuse bounce finding the emitter
+Color sample_emitters(const Hit_record &rec, const Hittable &world, const std::vector<Emitter> &emitters)
+{
+    Color direct(0, 0, 0);
+    for (const Emitter &emitter : emitters)
+    {
+        Vec3 direction;
+        double distance, light_pdf;
+        if (!emitter.sample(rec.p, direction, distance, light_pdf))
+            continue;
+        double cos_surface = rec.normal.dot(direction);
+        if (cos_surface <= 0 || world.occluded(Ray(rec.p, direction), 0.001, distance * 0.999))
+            continue;
+
+        double bsdf_pdf = cos_surface / pi;
+        double weight = power_heuristic(light_pdf, bsdf_pdf);
+        direct += emitter.material()->emit() * rec.mat_ptr->diffusecolor * static_cast<float>(bsdf_pdf * weight / light_pdf);
+    }
+    return direct;
+}
+
+// Solid angle pdf with which sample_emitters() would have produced the bounce
+// from origin that hit the emitter at rec; 0 for emissive geometry it does not sample
+double emitter_pdf(const Ray &bounce, const Hit_record &rec, const std::vector<Emitter> &emitters)
+{
+    double length = bounce.direction.length();
+    Ray unit_ray(bounce.origin, bounce.direction / length);
+    double distance = rec.t * length;
+    for (const Emitter &emitter : emitters)
+    {
+        double t;
+        if (emitter.material() == rec.mat_ptr && emitter.intersect(unit_ray, distance * 0.999, distance * 1.001, t))
+            return emitter.pdf(bounce.origin, unit_ray.direction, t);
+    }
+    return 0;
+}
+
+// Emissive spheres and triangles are sampled directly at every diffuse
+// vertex (next-event estimation) and also found by the BSDF bounces; the
+// power heuristic weights the two estimates, so small emitters converge fast
+// while large or nearby ones keep the low variance of BSDF sampling.
+Color path_tracer_BRDF(const Ray &r, const Hittable &world, const std::vector<Light> &lights,
+                       const std::vector<Emitter> &emitters, const Color &background_color, int max_depth)
+{
+    Color radiance(0, 0, 0);
+    Color throughput(1, 1, 1); // Product of the attenuations along the path so far
+    Ray ray = r;
+    double bsdf_pdf = 0; // Solid angle pdf of the last diffuse bounce, 0 after camera rays and specular bounces
+
+    for (int depth = 0; depth < max_depth; ++depth)
+    {
+        Hit_record rec;
+        if (!world.hit(ray, 0.001, inf, rec))
+        {
+            radiance += throughput * background_color; // Background color for rays that miss
+            break;
+        }
+
+        // Emissive component of the material, MIS weighted when emitter sampling could also have found it
+        Color emitted = rec.mat_ptr->emit();
+        if (bsdf_pdf > 0 && (emitted.x > 0 || emitted.y > 0 || emitted.z > 0))
+        {
+            double light_pdf = emitter_pdf(ray, rec, emitters);
+            if (light_pdf > 0)
+                emitted *= static_cast<float>(power_heuristic(bsdf_pdf, light_pdf));
+        }
+
+        Color lighting(0, 0, 0); // Contribution from direct lighting
+
+        // Direct lighting calculation
+        for (const auto &light : lights)
+        {
+            Vec3 light_dir = (light.position - rec.p).normalized();
+            Ray shadow_ray(rec.p, light_dir);
+
+            // Shadow check for visibility of the light
+            if (!world.occluded(shadow_ray, 0.001, (light.position - rec.p).length()))
+            {
+                // Lambertian Diffuse Component
+                float diff = fmax(0.0, rec.normal.dot(light_dir));
+                Color diffuse = diff * rec.mat_ptr->kd * rec.mat_ptr->diffusecolor * light.intensity;
+
+                // Blinn-Phong Specular Component
+                Vec3 view_dir = -ray.direction.normalized();
+                Vec3 halfway_dir = (light_dir + view_dir).normalized();
+                float spec_angle = fmax(0.0, rec.normal.dot(halfway_dir));
+                float spec = pow(spec_angle, rec.mat_ptr->specularexponent);
+                Color specular = spec * rec.mat_ptr->ks * rec.mat_ptr->specularcolor * light.intensity;
+
+                // Combine diffuse and specular contributions
+                lighting += diffuse + specular;
+            }
+        }
+
+        bool diffuse = is_diffuse(*rec.mat_ptr);
+        if (diffuse)
+            lighting += sample_emitters(rec, world, emitters);
+
+        radiance += throughput * (emitted + lighting);
+
+        // Indirect lighting (BRDF sampling) continues the path
+        Vec3 attenuation;
+        Ray scattered;
+        if (!rec.mat_ptr->scatter(ray, rec, attenuation, scattered))
+            break;
+        throughput *= attenuation;
+        bsdf_pdf = diffuse ? std::max(0.0f, rec.normal.dot(scattered.direction.normalized())) / pi : 0;
+
+        // Russian roulette: continue with probability p and divide by p, which
+        // keeps the estimate unbiased while dropping low-contribution paths
+        if (depth + 1 >= russian_roulette_min_depth)
+        {
+            double p = std::min(0.95f, std::max({throughput.x, throughput.y, throughput.z}));
+            if (p <= 0 || random_double() >= p)
+                break;
+            throughput *= 1.0f / static_cast<float>(p);
+        }
+
+        ray = scattered;
+    }
+
+    return radiance;
+}
+
+Color path_tracer(const Ray &r, const Hittable &world, const std::vector<Light> &lights,
+                  const Color &background_color, int depth)
+{
+    if (depth <= 0)
+        return Color(0, 0, 0);
+
+    Hit_record rec;
+    if (world.hit(r, 0.001, inf, rec))
+    {
+        Color emitted = rec.mat_ptr->emit();
+
+        Color lighting(0, 0, 0);
+
+        for (const auto &light : lights)
+        {
+            Vec3 light_dir = (light.position - rec.p).normalized();
+            Ray shadow_ray(rec.p, light_dir);
+
+            // Shadow check
+            if (!world.occluded(shadow_ray, 0.001, (light.position - rec.p).length()))
+            {
+                float diff = fmax(0.0, rec.normal.dot(light_dir));
+                Color diffuse = diff * rec.mat_ptr->kd * rec.mat_ptr->diffusecolor * light.intensity;
+
+                Vec3 view_dir = -r.direction.normalized();
+                Vec3 halfway_dir = (light_dir + view_dir).normalized();
+                float spec_angle = fmax(0.0, rec.normal.dot(halfway_dir));
+                float spec = pow(spec_angle, rec.mat_ptr->specularexponent);
+                Color specular = spec * rec.mat_ptr->ks * rec.mat_ptr->specularcolor * light.intensity;
+
+                lighting += diffuse + specular;
+            }
+        }
+
+        Color ambient(0.25, 0.25, 0.25); // This can be tweaked or passed as a scene parameter
+        lighting += ambient * rec.mat_ptr->diffusecolor;
+
+        if (rec.mat_ptr->isreflective && depth > 0)
+        {
+            Vec3 reflected_dir = reflect(r.direction.normalized(), rec.normal);
+            Ray reflected_ray(rec.p, reflected_dir);
+
+            float cos_theta = fmax(-reflected_dir.dot(rec.normal), 0.0);
+            float fresnel = rec.mat_ptr->reflectivity + (1.0 - rec.mat_ptr->reflectivity) * pow(1.0 - cos_theta, 5);
+
+            Color reflected_color = path_tracer(reflected_ray, world, lights, background_color, depth - 1);
+
+            lighting = lerp(lighting, reflected_color, fresnel);
+        }
+
+        return emitted + lighting;
+    }
+
+    return background_color;
+}
+
+// Everything a sample needs besides the pixel
+struct SampleContext
+{
+    const Camera &camera;
+    const Hittable &world;
+    const std::vector<Light> &lights;
+    const std::vector<Emitter> &emitters;
+    Color background_color;
+    int width, height;
+    int max_depth;
+    int TraceType;
+    SamplerType sampler = SamplerType::Random;
+    uint64_t seed = 1;
+};
+
+// One jittered camera sample of pixel (x, y); the pixel, lens and diffuse
+// bounce dimensions come from the sampler started for it
+Color trace_sample(const SampleContext &ctx, int x, int y)
+{
+    float u = (x + sample_1d()) / (ctx.width - 1);
+    float v = (y + sample_1d()) / (ctx.height - 1);
+    Ray ray = ctx.camera.get_ray(u, v);
+
+    if (ctx.TraceType == 1)
+        return Binary_Ray_Color(ray, ctx.world, ctx.background_color);
+    if (ctx.TraceType == 2)
+        return rayColor_Phong(ray, ctx.world, ctx.lights, ctx.background_color, ctx.max_depth);
+    if (ctx.TraceType == 3)
+        return rayColor(ray, ctx.world, ctx.lights, ctx.background_color, ctx.max_depth);
+    if (ctx.TraceType == 4)
+        return path_tracer(ray, ctx.world, ctx.lights, ctx.background_color, ctx.max_depth);
+    return path_tracer_BRDF(ray, ctx.world, ctx.lights, ctx.emitters, ctx.background_color, ctx.max_depth);
+}
+
+// Add samples to pixel i, continuing its own random sequence
+void sample_pixel(Film &film, const SampleContext &ctx, int x, int y, int samples)
+{
+    if (samples <= 0)
+        return;
+    size_t i = static_cast<size_t>(y) * ctx.width + x;
+    thread_rng() = film.rng[i];
+    for (int s = 0; s < samples; ++s)
+    {
+        start_pixel_sample(ctx.sampler, ctx.seed, x, y, film.samples[i]);
+        film.add(i, trace_sample(ctx, x, y));
+    }
+    film.rng[i] = thread_rng();
+}
+
+// Bring every pixel of the tile up to samples_per_pixel samples
+void render_tile(const Tile &tile, Film &film, const SampleContext &ctx, int samples_per_pixel)
+{
+    for (int y = tile.y0; y < tile.y1; ++y)
+    {
+        for (int x = tile.x0; x < tile.x1; ++x)
+        {
+            size_t i = static_cast<size_t>(y) * ctx.width + x;
+            sample_pixel(film, ctx, x, y, samples_per_pixel - static_cast<int>(film.samples[i]));
+        }
+    }
+}
+
+// Adaptive sampling: min_spp samples everywhere, then batches of min_spp more
+// while the pixel's relative error is above threshold, up to max_spp. Pixels
+// that already have samples continue from where they are.
+void render_tile_adaptive(const Tile &tile, Film &film, const SampleContext &ctx, int min_spp, int max_spp,
+                          double threshold)
+{
+    for (int y = tile.y0; y < tile.y1; ++y)
+    {
+        for (int x = tile.x0; x < tile.x1; ++x)
+        {
+            size_t i = static_cast<size_t>(y) * ctx.width + x;
+            sample_pixel(film, ctx, x, y, std::min(min_spp, max_spp) - static_cast<int>(film.samples[i]));
+            while (static_cast<int>(film.samples[i]) < max_spp && film.relative_error(i) > threshold)
+                sample_pixel(film, ctx, x, y, std::min(min_spp, max_spp - static_cast<int>(film.samples[i])));
+        }
+    }
+}
@@ -0,0 +1,675 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <future>
+#include "BVH.hpp"
+#include "Parallel.hpp"
+
+// 32-byte node stored in depth-first order: the first child of an inner node
+// directly follows it, only the second child needs an explicit offset
+struct LinearBVHNode
+{
+    float bounds_min[3];
+    union
+    {
+        uint32_t primitives_offset;   // leaf
+        uint32_t second_child_offset; // inner node
+    };
+    float bounds_max[3];
+    uint16_t n_primitives; // 0 for inner nodes
+    uint8_t axis;          // split axis, decides which child is visited first
+    uint8_t pad;
+};
+static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode must stay 32 bytes");
+
+// Same branch-free slab test as aabb::hit(const RayPrecomp &), on the packed node bounds
+inline bool node_hit(const LinearBVHNode &node, const RayPrecomp &r, float t_min, float t_max)
+{
+    for (int a = 0; a < 3; ++a)
+    {
+        float near_t = ((r.sign[a] ? node.bounds_max[a] : node.bounds_min[a]) - r.origin[a]) * r.inv_dir[a];
+        float far_t = ((r.sign[a] ? node.bounds_min[a] : node.bounds_max[a]) - r.origin[a]) * r.inv_dir[a];
+        t_min = near_t > t_min ? near_t : t_min;
+        t_max = far_t < t_max ? far_t : t_max;
+    }
+    return t_min <= t_max;
+}
+
+// Spread the low 10 bits of v so there are two zero bits between each
+inline uint32_t expand_bits_10(uint32_t v)
+{
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// Spread the low 21 bits of v so there are two zero bits between each
+inline uint64_t expand_bits_21(uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+// Morton code of a point inside bounds, interleaved as ...xyz with x in the highest bit of each triple
+inline uint64_t morton_code(const Vec3 &p, const aabb &bounds, int bits)
+{
+    const int axis_bits = bits >= 63 ? 21 : 10;
+    const float scale = static_cast<float>((1u << axis_bits) - 1);
+    uint64_t q[3];
+    for (int a = 0; a < 3; ++a)
+    {
+        float lo = axis_value(bounds.min(), a);
+        float extent = axis_value(bounds.max(), a) - lo;
+        float t = extent > 0 ? (axis_value(p, a) - lo) / extent : 0.0f;
+        q[a] = static_cast<uint64_t>(std::min(std::max(t * scale, 0.0f), scale));
+    }
+    if (axis_bits == 21)
+        return expand_bits_21(q[0]) << 2 | expand_bits_21(q[1]) << 1 | expand_bits_21(q[2]);
+    return expand_bits_10(q[0]) << 2 | expand_bits_10(q[1]) << 1 | expand_bits_10(q[2]);
+}
+
+// Counters for one or more traversals
+struct TraversalStats
+{
+    size_t rays = 0;
+    size_t node_tests = 0;      // ray / box slab tests
+    size_t primitive_tests = 0; // leaf_hit calls
+};
+
+// Node array plus the primitive order its leaves refer to. Leaves address a
+// contiguous slot range [primitives_offset, primitives_offset + n_primitives),
+// and indices[slot] maps a slot back to the caller's primitive index.
+class LinearBVHTree
+{
+public:
+    std::vector<LinearBVHNode> nodes;
+    std::vector<uint32_t> indices;
+    BVHBuildOptions build_options; // options of the last build, reused by rebuilds
+    double built_sah_cost = 0;     // SAH cost right after the last build, the refit baseline
+    int depth = 0;                 // most inner nodes on a root-to-leaf path, bounds the traversal stack
+
+    // SAH build over primitive references, ref.index is the caller's primitive index,
+    // or an LBVH build when options.method is Morton.
+    // With options.threads > 1, ranges above options.parallel_threshold are
+    // binned in parallel and their two subtrees are built as separate tasks.
+    void build(std::vector<BVHPrimRef> &refs, const BVHBuildOptions &options)
+    {
+        nodes.clear();
+        indices.clear();
+        depth = 0;
+        if (refs.empty())
+            return;
+        nodes.reserve(2 * refs.size());
+        indices.reserve(refs.size());
+        if (options.method == BVHSplitMethod::Morton)
+            build_morton(refs, options);
+        else
+            build_recursive(refs, 0, refs.size(), options, std::max(options.threads, 1));
+        build_options = options;
+        built_sah_cost = sah_cost(options);
+        depth = compute_depth();
+    }
+
+    // Nothing bounds the depth during the build: duplicate Morton codes or
+    // skewed SAH splits can make chains far deeper than log2 of the count
+    int compute_depth() const
+    {
+        std::vector<int> node_depth(nodes.size(), 0);
+        int deepest = 0;
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            if (nodes[i].n_primitives > 0)
+            {
+                deepest = std::max(deepest, node_depth[i]);
+                continue;
+            }
+            node_depth[i + 1] = node_depth[nodes[i].second_child_offset] = node_depth[i] + 1;
+        }
+        return deepest;
+    }
+
+    // Recompute every node box bottom-up from prim_box(slot) without touching
+    // the topology. Children always follow their parent in the array, so one
+    // reverse sweep sees both children before the parent.
+    template <typename PrimBox>
+    void refit(PrimBox &&prim_box)
+    {
+        for (size_t i = nodes.size(); i-- > 0;)
+        {
+            LinearBVHNode &node = nodes[i];
+            aabb box = aabb::empty();
+            if (node.n_primitives > 0)
+            {
+                for (uint32_t k = 0; k < node.n_primitives; ++k)
+                    box = surrounding_box(box, prim_box(node.primitives_offset + k));
+            }
+            else
+                box = surrounding_box(node_box(nodes[i + 1]), node_box(nodes[node.second_child_offset]));
+            set_box(node, box);
+        }
+    }
+
+    // SAH cost relative to the last build; refits of moving primitives make it grow
+    double quality_ratio() const
+    {
+        return built_sah_cost > 0 ? sah_cost(build_options) / built_sah_cost : 1.0;
+    }
+
+    // True once refitting has degraded the tree enough that a rebuild pays off
+    bool needs_rebuild(double max_ratio = 1.5) const { return quality_ratio() > max_ratio; }
+
+    // Expected cost of a random ray under the surface area heuristic
+    double sah_cost(const BVHBuildOptions &options) const
+    {
+        if (nodes.empty())
+            return 0;
+        return sah_cost(0, options);
+    }
+
+    aabb bounds() const
+    {
+        if (nodes.empty())
+            return aabb();
+        return node_box(nodes[0]);
+    }
+
+    static aabb node_box(const LinearBVHNode &node)
+    {
+        return aabb(Vec3(node.bounds_min[0], node.bounds_min[1], node.bounds_min[2]),
+                    Vec3(node.bounds_max[0], node.bounds_max[1], node.bounds_max[2]));
+    }
+
+    static void set_box(LinearBVHNode &node, const aabb &box)
+    {
+        node.bounds_min[0] = box.min().x;
+        node.bounds_min[1] = box.min().y;
+        node.bounds_min[2] = box.min().z;
+        node.bounds_max[0] = box.max().x;
+        node.bounds_max[1] = box.max().y;
+        node.bounds_max[2] = box.max().z;
+    }
+
+    // Closest-hit traversal. leaf_hit(slot, t_max) tests one primitive and
+    // shrinks t_max when it finds a closer hit.
+    template <typename LeafHit>
+    bool traverse(const Ray &r, double t_min, double t_max, LeafHit &&leaf_hit) const
+    {
+        return traverse_impl<false>(r, t_min, t_max, leaf_hit);
+    }
+
+    // Any-hit traversal, stops at the first leaf_hit(slot, t_max) that returns true
+    template <typename LeafHit>
+    bool any_hit(const Ray &r, double t_min, double t_max, LeafHit &&leaf_hit) const
+    {
+        return traverse_impl<true>(r, t_min, t_max, leaf_hit);
+    }
+
+    // Leaf-at-a-time variants for primitives stored in leaf order that are tested
+    // together: leaf_hit(first_slot, count, t_max) tests a whole leaf
+    template <typename LeafHit>
+    bool traverse_leaves(const Ray &r, double t_min, double t_max, LeafHit &&leaf_hit) const
+    {
+        return traverse_impl<false, LeafHit, false, true>(r, t_min, t_max, leaf_hit);
+    }
+
+    template <typename LeafHit>
+    bool any_hit_leaves(const Ray &r, double t_min, double t_max, LeafHit &&leaf_hit) const
+    {
+        return traverse_impl<true, LeafHit, false, true>(r, t_min, t_max, leaf_hit);
+    }
+
+    // Closest-hit traversal that also counts box and primitive tests
+    template <typename LeafHit>
+    bool traverse_counted(const Ray &r, double t_min, double t_max, LeafHit &&leaf_hit, TraversalStats &stats) const
+    {
+        stats.rays++;
+        return traverse_impl<false, LeafHit, true>(r, t_min, t_max, leaf_hit, &stats);
+    }
+
+private:
+    template <bool AnyHit, typename LeafHit, bool Counted = false, bool WholeLeaf = false>
+    bool traverse_impl(const Ray &r, double t_min, double t_max, LeafHit &leaf_hit, TraversalStats *stats = nullptr) const
+    {
+        if (nodes.empty())
+            return false;
+
+        RayPrecomp pr(r);
+
+        // Each inner node on the current path holds at most one pending child;
+        // trees deeper than the fixed buffer use a heap stack
+        uint32_t fixed_stack[64];
+        std::vector<uint32_t> deep_stack;
+        uint32_t *stack = fixed_stack;
+        if (depth > 64)
+        {
+            deep_stack.resize(depth);
+            stack = deep_stack.data();
+        }
+        int stack_size = 0;
+        uint32_t current = 0;
+        bool hit_anything = false;
+
+        while (true)
+        {
+            const LinearBVHNode &node = nodes[current];
+            if constexpr (Counted)
+                stats->node_tests++;
+            if (node_hit(node, pr, static_cast<float>(t_min), static_cast<float>(t_max)))
+            {
+                if (node.n_primitives > 0)
+                {
+                    if constexpr (Counted)
+                        stats->primitive_tests += node.n_primitives;
+                    if constexpr (WholeLeaf)
+                    {
+                        if (leaf_hit(node.primitives_offset, node.n_primitives, t_max))
+                        {
+                            if constexpr (AnyHit)
+                                return true;
+                            hit_anything = true;
+                        }
+                    }
+                    else
+                    {
+                        for (uint32_t i = 0; i < node.n_primitives; ++i)
+                        {
+                            if (leaf_hit(node.primitives_offset + i, t_max))
+                            {
+                                if constexpr (AnyHit)
+                                    return true;
+                                hit_anything = true;
+                            }
+                        }
+                    }
+                    if (stack_size == 0)
+                        break;
+                    current = stack[--stack_size];
+                }
+                else if (pr.sign[node.axis])
+                {
+                    stack[stack_size++] = current + 1;
+                    current = node.second_child_offset;
+                }
+                else
+                {
+                    stack[stack_size++] = node.second_child_offset;
+                    current = current + 1;
+                }
+            }
+            else
+            {
+                if (stack_size == 0)
+                    break;
+                current = stack[--stack_size];
+            }
+        }
+        return hit_anything;
+    }
+
+    double sah_cost(uint32_t index, const BVHBuildOptions &options) const
+    {
+        const LinearBVHNode &node = nodes[index];
+        if (node.n_primitives > 0)
+            return options.intersection_cost * node.n_primitives;
+
+        double inv_area = 1.0 / node_box(node).surface_area();
+        double cost = options.traversal_cost;
+        for (uint32_t child : {index + 1, node.second_child_offset})
+            cost += node_box(nodes[child]).surface_area() * inv_area * sah_cost(child, options);
+        return cost;
+    }
+
+    // Box and centroid bounds of refs[start, end), reduced over chunks when threads > 1
+    static void range_bounds(const std::vector<BVHPrimRef> &refs, size_t start, size_t end, int threads,
+                             aabb &box, aabb &centroid_bounds)
+    {
+        size_t chunks = threads > 1 ? static_cast<size_t>(threads) * 4 : 1;
+        std::vector<aabb> boxes(chunks, aabb::empty()), centroids(chunks, aabb::empty());
+        parallel_for(chunks, threads, [&](size_t c)
+                     {
+            for (size_t i = start + (end - start) * c / chunks; i < start + (end - start) * (c + 1) / chunks; ++i)
+            {
+                boxes[c] = surrounding_box(boxes[c], refs[i].box);
+                centroids[c] = surrounding_box(centroids[c], refs[i].centroid);
+            } });
+        box = aabb::empty();
+        centroid_bounds = aabb::empty();
+        for (size_t c = 0; c < chunks; ++c)
+        {
+            box = surrounding_box(box, boxes[c]);
+            centroid_bounds = surrounding_box(centroid_bounds, centroids[c]);
+        }
+    }
+
+    // find_sah_split with the binning split over chunks and the bins merged afterwards
+    static SAHSplit find_sah_split_parallel(const std::vector<BVHPrimRef> &refs, size_t start, size_t end, const aabb &box,
+                                            const aabb &centroid_bounds, const BVHBuildOptions &options, int threads)
+    {
+        size_t chunks = static_cast<size_t>(threads) * 4;
+        std::vector<SAHBins> binned(chunks, SAHBins(std::max(options.bins, 2), centroid_bounds));
+        parallel_for(chunks, threads, [&](size_t c)
+                     {
+            for (size_t i = start + (end - start) * c / chunks; i < start + (end - start) * (c + 1) / chunks; ++i)
+                binned[c].add(refs[i], centroid_bounds); });
+        for (size_t c = 1; c < chunks; ++c)
+            binned[0].merge(binned[c]);
+        return best_sah_split(binned[0], box, options);
+    }
+
+    // Append a separately built subtree, returns the index of its root
+    uint32_t append(const LinearBVHTree &subtree)
+    {
+        uint32_t node_base = static_cast<uint32_t>(nodes.size());
+        uint32_t index_base = static_cast<uint32_t>(indices.size());
+        for (LinearBVHNode node : subtree.nodes)
+        {
+            if (node.n_primitives > 0)
+                node.primitives_offset += index_base;
+            else
+                node.second_child_offset += node_base;
+            nodes.push_back(node);
+        }
+        indices.insert(indices.end(), subtree.indices.begin(), subtree.indices.end());
+        return node_base;
+    }
+
+    // LBVH: sort the centroids by Morton code with a parallel radix sort, then
+    // split every range where its codes first differ. Linear in the primitive
+    // count apart from the sort, and emits the same node layout as the SAH build.
+    void build_morton(const std::vector<BVHPrimRef> &refs, const BVHBuildOptions &options)
+    {
+        const int threads = std::max(options.threads, 1);
+        const int bits = options.morton_bits >= 63 ? 63 : 30;
+        aabb box, centroid_bounds;
+        range_bounds(refs, 0, refs.size(), threads, box, centroid_bounds);
+
+        std::vector<uint64_t> codes(refs.size());
+        std::vector<uint32_t> order(refs.size());
+        const size_t block = 1 << 14;
+        parallel_for((refs.size() + block - 1) / block, threads, [&](size_t b)
+                     {
+            for (size_t i = b * block; i < std::min(refs.size(), (b + 1) * block); ++i)
+            {
+                codes[i] = morton_code(refs[i].centroid, centroid_bounds, bits);
+                order[i] = static_cast<uint32_t>(i);
+            } });
+        radix_sort_pairs(codes, order, bits, threads);
+
+        build_morton_recursive(refs, codes, order, 0, refs.size(), bits, options, threads);
+    }
+
+    aabb build_morton_recursive(const std::vector<BVHPrimRef> &refs, const std::vector<uint64_t> &codes,
+                                const std::vector<uint32_t> &order, size_t start, size_t end, int bits,
+                                const BVHBuildOptions &options, int threads)
+    {
+        uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+        size_t span = end - start;
+
+        if (span <= static_cast<size_t>(std::min(std::max(options.max_leaf_size, 1), int(UINT16_MAX))))
+        {
+            aabb box = aabb::empty();
+            nodes[index].primitives_offset = static_cast<uint32_t>(indices.size());
+            nodes[index].n_primitives = static_cast<uint16_t>(span);
+            nodes[index].axis = 0;
+            for (size_t i = start; i < end; ++i)
+            {
+                box = surrounding_box(box, refs[order[i]].box);
+                indices.push_back(static_cast<uint32_t>(refs[order[i]].index));
+            }
+            set_box(nodes[index], box);
+            return box;
+        }
+
+        // Highest bit where the range's codes differ; the codes are sorted, so
+        // the first code with that bit set is found by binary search
+        size_t mid = start + span / 2;
+        int axis = -1;
+        uint64_t diff = codes[start] ^ codes[end - 1];
+        if (diff != 0)
+        {
+            int bit = 63 - __builtin_clzll(diff);
+            uint64_t mask = uint64_t(1) << bit;
+            mid = std::partition_point(codes.begin() + start, codes.begin() + end, [mask](uint64_t code)
+                                       { return (code & mask) == 0; }) -
+                  codes.begin();
+            axis = 2 - bit % 3;
+        }
+
+        aabb left_box, right_box;
+        uint32_t second;
+        if (threads > 1 && span >= options.parallel_threshold)
+        {
+            int left_threads = threads / 2;
+            LinearBVHTree left_tree, right_tree;
+            auto left_task = std::async(std::launch::async, [&]
+                                        { left_box = left_tree.build_morton_recursive(refs, codes, order, start, mid, bits, options, left_threads); });
+            right_box = right_tree.build_morton_recursive(refs, codes, order, mid, end, bits, options, threads - left_threads);
+            left_task.get();
+            append(left_tree);
+            second = append(right_tree);
+        }
+        else
+        {
+            left_box = build_morton_recursive(refs, codes, order, start, mid, bits, options, 1);
+            second = static_cast<uint32_t>(nodes.size());
+            right_box = build_morton_recursive(refs, codes, order, mid, end, bits, options, 1);
+        }
+
+        aabb box = surrounding_box(left_box, right_box);
+        set_box(nodes[index], box);
+        nodes[index].second_child_offset = second;
+        nodes[index].n_primitives = 0;
+        nodes[index].axis = static_cast<uint8_t>(axis >= 0 ? axis : box.longest_axis());
+        return box;
+    }
+
+    uint32_t build_recursive(std::vector<BVHPrimRef> &refs, size_t start, size_t end, const BVHBuildOptions &options,
+                             int threads)
+    {
+        uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+
+        size_t span = end - start;
+        bool parallel = threads > 1 && span >= options.parallel_threshold;
+
+        aabb box, centroid_bounds;
+        range_bounds(refs, start, end, parallel ? threads : 1, box, centroid_bounds);
+        set_box(nodes[index], box);
+
+        size_t max_leaf = std::min<size_t>(std::max(options.max_leaf_size, 1), UINT16_MAX);
+        SAHSplit split;
+        if (span > 1)
+            split = parallel ? find_sah_split_parallel(refs, start, end, box, centroid_bounds, options, threads)
+                             : find_sah_split(refs, start, end, box, centroid_bounds, options);
+
+        if (span == 1 || (span <= max_leaf && (split.axis < 0 || options.intersection_cost * span <= split.cost)))
+        {
+            nodes[index].primitives_offset = static_cast<uint32_t>(indices.size());
+            nodes[index].n_primitives = static_cast<uint16_t>(span);
+            nodes[index].axis = 0;
+            for (size_t i = start; i < end; ++i)
+                indices.push_back(static_cast<uint32_t>(refs[i].index));
+            return index;
+        }
+
+        int axis;
+        size_t mid;
+        if (split.axis >= 0)
+        {
+            axis = split.axis;
+            int bins = std::max(options.bins, 2);
+            auto middle = std::partition(refs.begin() + start, refs.begin() + end, [&](const BVHPrimRef &ref)
+                                         { return sah_bin_index(ref.centroid, centroid_bounds, axis, bins) <= split.bin; });
+            mid = middle - refs.begin();
+        }
+        else
+        {
+            axis = box.longest_axis();
+            mid = start + span / 2;
+            std::nth_element(refs.begin() + start, refs.begin() + mid, refs.begin() + end,
+                             [axis](const BVHPrimRef &a, const BVHPrimRef &b)
+                             { return axis_value(a.centroid, axis) < axis_value(b.centroid, axis); });
+        }
+
+        uint32_t second;
+        if (parallel)
+        {
+            // The halves own disjoint ref ranges, so the left one can be built as a task
+            int left_threads = threads / 2;
+            LinearBVHTree left_tree, right_tree;
+            auto left_task = std::async(std::launch::async, [&]
+                                        { left_tree.build_recursive(refs, start, mid, options, left_threads); });
+            right_tree.build_recursive(refs, mid, end, options, threads - left_threads);
+            left_task.get();
+            append(left_tree);
+            second = append(right_tree);
+        }
+        else
+        {
+            build_recursive(refs, start, mid, options, 1);
+            second = build_recursive(refs, mid, end, options, 1);
+        }
+        nodes[index].second_child_offset = second;
+        nodes[index].n_primitives = 0;
+        nodes[index].axis = static_cast<uint8_t>(axis);
+        return index;
+    }
+};
+
+// Flattened BVH over scene objects. Can be built directly or from an existing
+// BVHNode tree, and traverses the node array with an explicit stack.
+class LinearBVH : public Hittable
+{
+public:
+    LinearBVHTree tree;
+    std::vector<shared_ptr<Hittable>> primitives; // in leaf slot order
+
+    LinearBVH() {}
+
+    LinearBVH(const std::vector<shared_ptr<Hittable>> &objects, const BVHBuildOptions &options = BVHBuildOptions(),
+              double time0 = 0, double time1 = 0)
+    {
+        std::vector<BVHPrimRef> refs;
+        refs.reserve(objects.size());
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            aabb b;
+            if (!objects[i]->bounding_box(time0, time1, b))
+                std::cerr << "No bounding box in LinearBVH constructor.\n";
+            refs.push_back({b, b.centroid(), i});
+        }
+        tree.build(refs, options);
+
+        primitives.reserve(objects.size());
+        for (uint32_t index : tree.indices)
+            primitives.push_back(objects[index]);
+    }
+
+    explicit LinearBVH(const BVHNode &root)
+    {
+        flatten(root);
+        tree.indices.resize(primitives.size());
+        for (uint32_t i = 0; i < tree.indices.size(); ++i)
+            tree.indices[i] = i;
+        tree.built_sah_cost = tree.sah_cost(tree.build_options);
+        tree.depth = tree.compute_depth();
+    }
+
+    // Update the boxes after primitives moved, keeping the tree topology
+    void refit(double time0 = 0, double time1 = 0)
+    {
+        tree.refit([&](uint32_t slot)
+                   {
+            aabb box;
+            primitives[slot]->bounding_box(time0, time1, box);
+            return box; });
+    }
+
+    // Refit, or rebuild with the last build options once the SAH cost has grown
+    // past max_ratio times its value after the last build. Returns true on a rebuild.
+    bool update(double time0 = 0, double time1 = 0, double max_ratio = 1.5)
+    {
+        refit(time0, time1);
+        if (!tree.needs_rebuild(max_ratio))
+            return false;
+        *this = LinearBVH(std::vector<shared_ptr<Hittable>>(primitives), tree.build_options, time0, time1);
+        return true;
+    }
+
+    bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const override
+    {
+        return tree.traverse(r, t_min, t_max, [&](uint32_t slot, double &closest)
+                             {
+            if (!primitives[slot]->hit(r, t_min, closest, rec))
+                return false;
+            closest = rec.t;
+            return true; });
+    }
+
+    bool occluded(const Ray &r, double t_min, double t_max) const override
+    {
+        return tree.any_hit(r, t_min, t_max, [&](uint32_t slot, double &closest)
+                            { return primitives[slot]->occluded(r, t_min, closest); });
+    }
+
+    bool bounding_box(double t0, double t1, aabb &output_box) const override
+    {
+        if (tree.nodes.empty())
+            return false;
+        output_box = tree.bounds();
+        return true;
+    }
+
+private:
+    uint32_t add_leaf(const aabb &box, const std::vector<shared_ptr<Hittable>> &objects)
+    {
+        uint32_t index = static_cast<uint32_t>(tree.nodes.size());
+        tree.nodes.emplace_back();
+        LinearBVHTree::set_box(tree.nodes[index], box);
+        tree.nodes[index].primitives_offset = static_cast<uint32_t>(primitives.size());
+        tree.nodes[index].n_primitives = static_cast<uint16_t>(objects.size());
+        tree.nodes[index].axis = 0;
+        primitives.insert(primitives.end(), objects.begin(), objects.end());
+        return index;
+    }
+
+    uint32_t flatten_child(const shared_ptr<Hittable> &child)
+    {
+        if (auto node = std::dynamic_pointer_cast<BVHNode>(child))
+            return flatten(*node);
+        aabb box;
+        child->bounding_box(0, 0, box);
+        return add_leaf(box, {child});
+    }
+
+    uint32_t flatten(const BVHNode &node)
+    {
+        if (node.is_leaf())
+            return add_leaf(node.box, node.primitives);
+
+        // The median builder stores a single primitive as left == right
+        if (node.left == node.right)
+            return flatten_child(node.left);
+
+        uint32_t index = static_cast<uint32_t>(tree.nodes.size());
+        tree.nodes.emplace_back();
+        LinearBVHTree::set_box(tree.nodes[index], node.box);
+
+        flatten_child(node.left);
+        uint32_t second = flatten_child(node.right);
+        tree.nodes[index].second_child_offset = second;
+        tree.nodes[index].n_primitives = 0;
+        tree.nodes[index].axis = static_cast<uint8_t>(node.axis);
+        return index;
+    }
+};
@@ -0,0 +1,774 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "utility.hpp"
+#include "Parallel.hpp"
+
+// Vertex and index buffers ready to be moved into a TriangleMesh
+struct MeshData
+{
+    std::vector<Vec3> positions;
+    std::vector<Vec3> normals; // empty or one per position
+    std::vector<float> uvs;    // empty or two per position
+    std::vector<uint32_t> indices;
+};
+
+// Consistency checks for mesh data that did not come through a loader, such as
+// inline scene JSON; name prefixes the error message
+inline bool validate_mesh(const MeshData &mesh, const std::string &name, std::string &error)
+{
+    if (mesh.indices.empty() || mesh.indices.size() % 3 != 0)
+        error = name + " needs a non-empty index count that is a multiple of 3";
+    else if (std::any_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t i)
+                         { return i >= mesh.positions.size(); }))
+        error = name + " has an index out of range";
+    else if (!mesh.normals.empty() && mesh.normals.size() != mesh.positions.size())
+        error = name + " needs one normal per position";
+    else if (!mesh.uvs.empty() && mesh.uvs.size() != 2 * mesh.positions.size())
+        error = name + " needs two uvs per position";
+    else
+        return true;
+    return false;
+}
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+                ptr = static_cast<const char *>(p);
+                length = st.st_size;
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (ptr)
+            ::munmap(const_cast<char *>(ptr), length);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool is_open() const { return ptr != nullptr; }
+    const char *data() const { return ptr; }
+    size_t size() const { return length; }
+
+private:
+    const char *ptr = nullptr;
+    size_t length = 0;
+};
+
+namespace mesh_loader
+{
+    inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    inline const char *skip_spaces(const char *p, const char *end)
+    {
+        while (p < end && is_space(*p))
+            ++p;
+        return p;
+    }
+
+    inline const char *line_end(const char *p, const char *end)
+    {
+        const void *nl = std::memchr(p, '\n', end - p);
+        return nl ? static_cast<const char *>(nl) : end;
+    }
+
+    // Start of the line after the one ending at eol; end when there is no newline
+    inline const char *next_line(const char *eol, const char *end)
+    {
+        return eol < end ? eol + 1 : end;
+    }
+
+    // True when count records of stride bytes fit in [p, end), without overflowing count * stride
+    inline bool fits(size_t count, size_t stride, const char *p, const char *end)
+    {
+        return stride == 0 || count <= size_t(end - p) / stride;
+    }
+
+    inline bool parse_float(const char *&p, const char *end, float &out)
+    {
+        p = skip_spaces(p, end);
+        if (p < end && *p == '+')
+            ++p;
+        auto result = std::from_chars(p, end, out);
+        if (result.ec != std::errc())
+            return false;
+        p = result.ptr;
+        return true;
+    }
+
+    inline bool parse_int(const char *&p, const char *end, long &out)
+    {
+        auto result = std::from_chars(p, end, out);
+        if (result.ec != std::errc())
+            return false;
+        p = result.ptr;
+        return true;
+    }
+
+    // Split [data, data + size) into about `count` pieces that end on line breaks
+    inline std::vector<size_t> line_chunks(const char *data, size_t size, size_t count)
+    {
+        std::vector<size_t> bounds = {0};
+        for (size_t i = 1; i < count; ++i)
+        {
+            size_t pos = std::max(size * i / count, bounds.back());
+            const char *nl = line_end(data + pos, data + size);
+            pos = nl == data + size ? size : nl - data + 1;
+            if (pos > bounds.back() && pos < size)
+                bounds.push_back(pos);
+        }
+        bounds.push_back(size);
+        return bounds;
+    }
+
+    struct ObjCounts
+    {
+        size_t positions = 0, normals = 0, uvs = 0, triangles = 0;
+    };
+
+    // Number of vertex references on a face line, p points after "f"
+    inline size_t count_corners(const char *p, const char *end)
+    {
+        size_t corners = 0;
+        while (true)
+        {
+            p = skip_spaces(p, end);
+            if (p >= end || *p == '#')
+                return corners;
+            ++corners;
+            while (p < end && !is_space(*p))
+                ++p;
+        }
+    }
+
+    // OBJ index to 0-based: positive indices are 1-based, negative ones count back from the last element seen
+    inline int64_t resolve_index(long index, size_t seen)
+    {
+        if (index > 0)
+            return index - 1;
+        if (index < 0)
+            return static_cast<int64_t>(seen) + index;
+        return -1;
+    }
+}
+
+// Wavefront OBJ: v, vn, vt and polygonal f lines, polygons are fan
+// triangulated and everything else is ignored. The mapped file is split into
+// line-aligned chunks that are parsed in parallel twice: once to count
+// elements, which gives every chunk its output offsets, and once to parse
+// straight into the final arrays.
+inline bool load_obj(const std::string &path, MeshData &mesh, std::string &error, int num_threads = default_thread_count())
+{
+    using namespace mesh_loader;
+    MappedFile file(path);
+    if (!file.is_open())
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    const char *data = file.data();
+    std::vector<size_t> bounds = line_chunks(data, file.size(), std::max(num_threads, 1) * 8);
+    size_t n_chunks = bounds.size() - 1;
+
+    std::vector<ObjCounts> counts(n_chunks);
+    parallel_for(n_chunks, num_threads, [&](size_t c)
+                 {
+        const char *end = data + bounds[c + 1];
+        for (const char *p = data + bounds[c]; p < end;)
+        {
+            const char *eol = line_end(p, end);
+            const char *s = skip_spaces(p, eol);
+            if (eol - s >= 2 && s[0] == 'v' && is_space(s[1]))
+                counts[c].positions++;
+            else if (eol - s >= 3 && s[0] == 'v' && s[1] == 'n' && is_space(s[2]))
+                counts[c].normals++;
+            else if (eol - s >= 3 && s[0] == 'v' && s[1] == 't' && is_space(s[2]))
+                counts[c].uvs++;
+            else if (eol - s >= 2 && s[0] == 'f' && is_space(s[1]))
+            {
+                size_t corners = count_corners(s + 1, eol);
+                if (corners >= 3)
+                    counts[c].triangles += corners - 2;
+            }
+            p = next_line(eol, end);
+        } });
+
+    // Exclusive prefix sums: where each chunk writes and how many elements precede it
+    std::vector<ObjCounts> offsets(n_chunks + 1);
+    for (size_t c = 0; c < n_chunks; ++c)
+    {
+        offsets[c + 1].positions = offsets[c].positions + counts[c].positions;
+        offsets[c + 1].normals = offsets[c].normals + counts[c].normals;
+        offsets[c + 1].uvs = offsets[c].uvs + counts[c].uvs;
+        offsets[c + 1].triangles = offsets[c].triangles + counts[c].triangles;
+    }
+    const ObjCounts &total = offsets[n_chunks];
+    if (total.triangles == 0)
+    {
+        error = path + " has no faces";
+        return false;
+    }
+
+    std::vector<Vec3> positions(total.positions), normals(total.normals);
+    std::vector<float> uvs(2 * total.uvs);
+    // Per corner position / uv / normal index, -1 when the face has none. The
+    // uv and normal indices are only kept when the file has those attributes.
+    std::vector<int32_t> corner_p(3 * total.triangles);
+    std::vector<int32_t> corner_t(total.uvs > 0 ? 3 * total.triangles : 0);
+    std::vector<int32_t> corner_n(total.normals > 0 ? 3 * total.triangles : 0);
+    std::vector<std::string> errors(n_chunks);
+
+    parallel_for(n_chunks, num_threads, [&](size_t c)
+                 {
+        ObjCounts at = offsets[c];
+        const char *end = data + bounds[c + 1];
+        int64_t face[3][3];
+        for (const char *p = data + bounds[c]; p < end && errors[c].empty();)
+        {
+            const char *eol = line_end(p, end);
+            const char *s = skip_spaces(p, eol);
+            bool ok = true;
+            if (eol - s >= 2 && s[0] == 'v' && is_space(s[1]))
+            {
+                s += 1;
+                Vec3 &v = positions[at.positions++];
+                ok = parse_float(s, eol, v.x) && parse_float(s, eol, v.y) && parse_float(s, eol, v.z);
+            }
+            else if (eol - s >= 3 && s[0] == 'v' && s[1] == 'n' && is_space(s[2]))
+            {
+                s += 2;
+                Vec3 &n = normals[at.normals++];
+                ok = parse_float(s, eol, n.x) && parse_float(s, eol, n.y) && parse_float(s, eol, n.z);
+            }
+            else if (eol - s >= 3 && s[0] == 'v' && s[1] == 't' && is_space(s[2]))
+            {
+                s += 2;
+                size_t i = at.uvs++;
+                ok = parse_float(s, eol, uvs[2 * i]) && parse_float(s, eol, uvs[2 * i + 1]);
+            }
+            else if (eol - s >= 2 && s[0] == 'f' && is_space(s[1]))
+            {
+                s += 1;
+                int corner = 0;
+                while (ok)
+                {
+                    s = skip_spaces(s, eol);
+                    if (s >= eol || *s == '#')
+                        break;
+                    // p, p/t, p//n or p/t/n
+                    long values[3] = {0, 0, 0};
+                    ok = parse_int(s, eol, values[0]);
+                    for (int k = 1; ok && k < 3 && s < eol && *s == '/'; ++k)
+                    {
+                        ++s;
+                        if (s < eol && *s != '/' && !is_space(*s))
+                            ok = parse_int(s, eol, values[k]);
+                    }
+                    int64_t p_index = resolve_index(values[0], at.positions);
+                    int64_t t_index = resolve_index(values[1], at.uvs);
+                    int64_t n_index = resolve_index(values[2], at.normals);
+                    if (corner < 2)
+                    {
+                        face[corner][0] = p_index, face[corner][1] = t_index, face[corner][2] = n_index;
+                    }
+                    else
+                    {
+                        // Fan triangle (first, previous, current)
+                        size_t base = 3 * at.triangles++;
+                        int64_t current[3] = {p_index, t_index, n_index};
+                        const int64_t *tri[3] = {face[0], face[1], current};
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            corner_p[base + k] = static_cast<int32_t>(tri[k][0]);
+                            if (!corner_t.empty())
+                                corner_t[base + k] = static_cast<int32_t>(tri[k][1]);
+                            if (!corner_n.empty())
+                                corner_n[base + k] = static_cast<int32_t>(tri[k][2]);
+                        }
+                        std::copy(current, current + 3, face[1]);
+                    }
+                    ++corner;
+                }
+            }
+            if (!ok)
+            {
+                size_t line = std::count(data, p, '\n') + 1;
+                errors[c] = path + ":" + std::to_string(line) + ": malformed line";
+            }
+            p = next_line(eol, end);
+        } });
+
+    for (const std::string &e : errors)
+    {
+        if (!e.empty())
+        {
+            error = e;
+            return false;
+        }
+    }
+
+    // Check the indices and whether uv / normal indices follow the position
+    // indices, in which case the position index buffer can be used as is
+    std::vector<uint8_t> chunk_bad(n_chunks, 0), chunk_split(n_chunks, 0), chunk_no_t(n_chunks, 0), chunk_no_n(n_chunks, 0);
+    size_t n_corners = corner_p.size();
+    parallel_for(n_chunks, num_threads, [&](size_t c)
+                 {
+        for (size_t i = n_corners * c / n_chunks; i < n_corners * (c + 1) / n_chunks; ++i)
+        {
+            int64_t p = corner_p[i];
+            int64_t t = corner_t.empty() ? -1 : corner_t[i];
+            int64_t n = corner_n.empty() ? -1 : corner_n[i];
+            if (p < 0 || p >= static_cast<int64_t>(total.positions) || t >= static_cast<int64_t>(total.uvs) ||
+                n >= static_cast<int64_t>(total.normals))
+                chunk_bad[c] = 1;
+            chunk_no_t[c] |= t < 0;
+            chunk_no_n[c] |= n < 0;
+            chunk_split[c] |= (t >= 0 && t != p) || (n >= 0 && n != p);
+        } });
+    auto any = [](const std::vector<uint8_t> &flags)
+    { return std::find(flags.begin(), flags.end(), 1) != flags.end(); };
+    if (any(chunk_bad))
+    {
+        error = path + " has a face index out of range";
+        return false;
+    }
+    bool has_uvs = total.uvs > 0 && !any(chunk_no_t);
+    bool has_normals = total.normals > 0 && !any(chunk_no_n);
+
+    mesh = MeshData();
+    if (!any(chunk_split) && (!has_uvs || total.uvs == total.positions) && (!has_normals || total.normals == total.positions))
+    {
+        mesh.positions = std::move(positions);
+        if (has_normals)
+            mesh.normals = std::move(normals);
+        if (has_uvs)
+            mesh.uvs = std::move(uvs);
+        mesh.indices.assign(corner_p.begin(), corner_p.end());
+        return true;
+    }
+
+    // Attributes indexed independently: give every corner its own vertex
+    mesh.positions.resize(n_corners);
+    mesh.indices.resize(n_corners);
+    if (has_normals)
+        mesh.normals.resize(n_corners);
+    if (has_uvs)
+        mesh.uvs.resize(2 * n_corners);
+    parallel_for(n_chunks, num_threads, [&](size_t c)
+                 {
+        for (size_t i = n_corners * c / n_chunks; i < n_corners * (c + 1) / n_chunks; ++i)
+        {
+            mesh.indices[i] = static_cast<uint32_t>(i);
+            mesh.positions[i] = positions[corner_p[i]];
+            if (has_normals)
+                mesh.normals[i] = normals[corner_n[i]];
+            if (has_uvs)
+            {
+                mesh.uvs[2 * i] = uvs[2 * corner_t[i]];
+                mesh.uvs[2 * i + 1] = uvs[2 * corner_t[i] + 1];
+            }
+        } });
+    return true;
+}
+
+namespace mesh_loader
+{
+    enum class PlyType
+    {
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Float32,
+        Float64,
+        Invalid
+    };
+
+    inline PlyType ply_type(const std::string &name)
+    {
+        if (name == "char" || name == "int8")
+            return PlyType::Int8;
+        if (name == "uchar" || name == "uint8")
+            return PlyType::UInt8;
+        if (name == "short" || name == "int16")
+            return PlyType::Int16;
+        if (name == "ushort" || name == "uint16")
+            return PlyType::UInt16;
+        if (name == "int" || name == "int32")
+            return PlyType::Int32;
+        if (name == "uint" || name == "uint32")
+            return PlyType::UInt32;
+        if (name == "float" || name == "float32")
+            return PlyType::Float32;
+        if (name == "double" || name == "float64")
+            return PlyType::Float64;
+        return PlyType::Invalid;
+    }
+
+    inline size_t ply_size(PlyType type)
+    {
+        static const size_t sizes[] = {1, 1, 2, 2, 4, 4, 4, 8, 0};
+        return sizes[static_cast<int>(type)];
+    }
+
+    inline double ply_read(const char *p, PlyType type, bool swap)
+    {
+        unsigned char bytes[8];
+        size_t n = ply_size(type);
+        for (size_t i = 0; i < n; ++i)
+            bytes[i] = p[swap ? n - 1 - i : i];
+        switch (type)
+        {
+        case PlyType::Int8:
+            return static_cast<int8_t>(bytes[0]);
+        case PlyType::UInt8:
+            return bytes[0];
+        case PlyType::Int16:
+        {
+            int16_t v;
+            std::memcpy(&v, bytes, 2);
+            return v;
+        }
+        case PlyType::UInt16:
+        {
+            uint16_t v;
+            std::memcpy(&v, bytes, 2);
+            return v;
+        }
+        case PlyType::Int32:
+        {
+            int32_t v;
+            std::memcpy(&v, bytes, 4);
+            return v;
+        }
+        case PlyType::UInt32:
+        {
+            uint32_t v;
+            std::memcpy(&v, bytes, 4);
+            return v;
+        }
+        case PlyType::Float32:
+        {
+            float v;
+            std::memcpy(&v, bytes, 4);
+            return v;
+        }
+        case PlyType::Float64:
+        {
+            double v;
+            std::memcpy(&v, bytes, 8);
+            return v;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    struct PlyProperty
+    {
+        std::string name;
+        PlyType type = PlyType::Invalid;
+        PlyType count_type = PlyType::Invalid; // set for list properties
+        size_t offset = 0;
+    };
+
+    struct PlyElement
+    {
+        std::string name;
+        size_t count = 0;
+        size_t stride = 0; // bytes per element when it has no list property
+        std::vector<PlyProperty> properties;
+
+        const PlyProperty *find(std::initializer_list<const char *> names) const
+        {
+            for (const auto &property : properties)
+                for (const char *name : names)
+                    if (property.name == name)
+                        return &property;
+            return nullptr;
+        }
+    };
+}
+
+// Binary PLY (little or big endian) with a vertex element (x, y, z and
+// optionally nx, ny, nz and u, v) and a face element with one index list.
+// Vertices and all-triangle faces have a fixed stride and are decoded in
+// parallel; faces with other vertex counts are fan triangulated in one pass.
+inline bool load_ply(const std::string &path, MeshData &mesh, std::string &error, int num_threads = default_thread_count())
+{
+    using namespace mesh_loader;
+    MappedFile file(path);
+    if (!file.is_open())
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    const char *data = file.data();
+    const char *end = data + file.size();
+
+    // Header
+    std::vector<PlyElement> elements;
+    bool swap = false;
+    const char *p = data;
+    bool header_done = false;
+    for (int line_no = 0; p < end && !header_done; ++line_no)
+    {
+        const char *eol = line_end(p, end);
+        std::string line(p, eol);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        p = next_line(eol, end);
+
+        std::stringstream ss(line);
+        std::string keyword;
+        ss >> keyword;
+        if (line_no == 0)
+        {
+            if (keyword != "ply")
+            {
+                error = path + " is not a PLY file";
+                return false;
+            }
+        }
+        else if (keyword == "format")
+        {
+            std::string format;
+            ss >> format;
+            uint16_t probe = 1;
+            bool little_endian_host = *reinterpret_cast<uint8_t *>(&probe) == 1;
+            if (format == "binary_little_endian")
+                swap = !little_endian_host;
+            else if (format == "binary_big_endian")
+                swap = little_endian_host;
+            else
+            {
+                error = path + ": only binary PLY is supported";
+                return false;
+            }
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            ss >> element.name >> element.count;
+            elements.push_back(element);
+        }
+        else if (keyword == "property" && !elements.empty())
+        {
+            PlyProperty property;
+            std::string type;
+            ss >> type;
+            if (type == "list")
+            {
+                std::string count_type, item_type;
+                ss >> count_type >> item_type;
+                property.count_type = ply_type(count_type);
+                property.type = ply_type(item_type);
+                if (property.count_type == PlyType::Invalid)
+                    property.type = PlyType::Invalid;
+            }
+            else
+                property.type = ply_type(type);
+            ss >> property.name;
+            if (property.type == PlyType::Invalid)
+            {
+                error = path + ": unknown property type in '" + line + "'";
+                return false;
+            }
+            PlyElement &element = elements.back();
+            property.offset = element.stride;
+            element.stride += ply_size(property.count_type == PlyType::Invalid ? property.type : property.count_type);
+            element.properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+            header_done = eol < end; // the binary data starts after its newline
+    }
+    if (!header_done)
+    {
+        error = path + ": missing end_header";
+        return false;
+    }
+
+    mesh = MeshData();
+    std::vector<uint32_t> indices;
+    for (const PlyElement &element : elements)
+    {
+        bool has_list = false;
+        for (const auto &property : element.properties)
+            has_list |= property.count_type != PlyType::Invalid;
+
+        if (element.name == "vertex")
+        {
+            const PlyProperty *x = element.find({"x"}), *y = element.find({"y"}), *z = element.find({"z"});
+            const PlyProperty *nx = element.find({"nx"}), *ny = element.find({"ny"}), *nz = element.find({"nz"});
+            const PlyProperty *u = element.find({"u", "s", "texture_u"}), *v = element.find({"v", "t", "texture_v"});
+            if (!x || !y || !z || has_list || !fits(element.count, element.stride, p, end))
+            {
+                error = path + ": unsupported or truncated vertex element";
+                return false;
+            }
+            bool with_normals = nx && ny && nz;
+            bool with_uvs = u && v;
+            mesh.positions.resize(element.count);
+            if (with_normals)
+                mesh.normals.resize(element.count);
+            if (with_uvs)
+                mesh.uvs.resize(2 * element.count);
+
+            const size_t block = 1 << 14;
+            parallel_for((element.count + block - 1) / block, num_threads, [&](size_t b)
+                         {
+                for (size_t i = b * block; i < std::min(element.count, (b + 1) * block); ++i)
+                {
+                    const char *vertex = p + i * element.stride;
+                    auto read = [&](const PlyProperty *property)
+                    { return static_cast<float>(ply_read(vertex + property->offset, property->type, swap)); };
+                    mesh.positions[i] = Vec3(read(x), read(y), read(z));
+                    if (with_normals)
+                        mesh.normals[i] = Vec3(read(nx), read(ny), read(nz));
+                    if (with_uvs)
+                    {
+                        mesh.uvs[2 * i] = read(u);
+                        mesh.uvs[2 * i + 1] = read(v);
+                    }
+                } });
+            p += element.count * element.stride;
+        }
+        else if (element.name == "face")
+        {
+            const PlyProperty *list = element.find({"vertex_indices", "vertex_index"});
+            if (!list || element.properties.size() != 1)
+            {
+                error = path + ": face element must hold just a vertex index list";
+                return false;
+            }
+            size_t count_size = ply_size(list->count_type);
+            size_t index_size = ply_size(list->type);
+            size_t tri_stride = count_size + 3 * index_size;
+
+            // Fast path when every face is a triangle: fixed stride, decode in parallel
+            bool all_triangles = fits(element.count, tri_stride, p, end);
+            const size_t block = 1 << 14;
+            size_t n_blocks = (element.count + block - 1) / block;
+            if (all_triangles)
+            {
+                std::vector<uint8_t> block_ok(n_blocks, 1);
+                parallel_for(n_blocks, num_threads, [&](size_t b)
+                             {
+                    for (size_t i = b * block; i < std::min(element.count, (b + 1) * block); ++i)
+                        if (ply_read(p + i * tri_stride, list->count_type, swap) != 3)
+                        {
+                            block_ok[b] = 0;
+                            return;
+                        } });
+                all_triangles = std::find(block_ok.begin(), block_ok.end(), 0) == block_ok.end();
+            }
+
+            if (all_triangles)
+            {
+                indices.resize(3 * element.count);
+                parallel_for(n_blocks, num_threads, [&](size_t b)
+                             {
+                    for (size_t i = b * block; i < std::min(element.count, (b + 1) * block); ++i)
+                    {
+                        const char *face = p + i * tri_stride + count_size;
+                        for (int k = 0; k < 3; ++k)
+                            indices[3 * i + k] = static_cast<uint32_t>(ply_read(face + k * index_size, list->type, swap));
+                    } });
+                p += element.count * tri_stride;
+            }
+            else
+            {
+                for (size_t i = 0; i < element.count; ++i)
+                {
+                    if (size_t(end - p) < count_size)
+                    {
+                        error = path + ": truncated face element";
+                        return false;
+                    }
+                    size_t n = static_cast<size_t>(ply_read(p, list->count_type, swap));
+                    p += count_size;
+                    if (!fits(n, index_size, p, end))
+                    {
+                        error = path + ": truncated face element";
+                        return false;
+                    }
+                    for (size_t k = 2; k < n; ++k)
+                    {
+                        indices.push_back(static_cast<uint32_t>(ply_read(p, list->type, swap)));
+                        indices.push_back(static_cast<uint32_t>(ply_read(p + (k - 1) * index_size, list->type, swap)));
+                        indices.push_back(static_cast<uint32_t>(ply_read(p + k * index_size, list->type, swap)));
+                    }
+                    p += n * index_size;
+                }
+            }
+        }
+        else
+        {
+            // Skip other elements with a fixed layout
+            if (has_list || !fits(element.count, element.stride, p, end))
+            {
+                error = path + ": cannot skip element '" + element.name + "'";
+                return false;
+            }
+            p += element.count * element.stride;
+        }
+    }
+
+    for (uint32_t index : indices)
+    {
+        if (index >= mesh.positions.size())
+        {
+            error = path + " has a face index out of range";
+            return false;
+        }
+    }
+    if (indices.empty())
+    {
+        error = path + " has no faces";
+        return false;
+    }
+    mesh.indices = std::move(indices);
+    return true;
+}
+
+// Pick the loader from the file extension
+inline bool load_mesh(const std::string &path, MeshData &mesh, std::string &error, int num_threads = default_thread_count())
+{
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == "obj")
+        return load_obj(path, mesh, error, num_threads);
+    if (extension == "ply")
+        return load_ply(path, mesh, error, num_threads);
+    error = "unsupported mesh format: " + path;
+    return false;
+}
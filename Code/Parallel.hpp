@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+inline int default_thread_count()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Call fn(i) for every i in [0, count) on up to num_threads threads. Items are
+// claimed through an atomic counter, so uneven items still balance.
+template <typename Fn>
+void parallel_for(size_t count, int num_threads, Fn &&fn)
+{
+    size_t workers = std::min<size_t>(std::max(num_threads, 1), count);
+    if (workers <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+            fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]
+    {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+            fn(i);
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < workers; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+}
+
+// Stable LSD radix sort of (key, value) pairs on the low key_bits bits, 8 bits
+// per pass. Every pass counts digits per chunk in parallel, turns the counts
+// into per-chunk output offsets and scatters the chunks in parallel.
+inline void radix_sort_pairs(std::vector<uint64_t> &keys, std::vector<uint32_t> &values, int key_bits, int num_threads)
+{
+    const size_t n = keys.size();
+    const size_t buckets = 256;
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(std::max(num_threads, 1), n / 4096));
+    std::vector<uint64_t> keys_out(n);
+    std::vector<uint32_t> values_out(n);
+    std::vector<size_t> offsets(chunks * buckets);
+
+    for (int shift = 0; shift < key_bits; shift += 8)
+    {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        parallel_for(chunks, num_threads, [&](size_t c)
+                     {
+            size_t *count = &offsets[c * buckets];
+            for (size_t i = n * c / chunks; i < n * (c + 1) / chunks; ++i)
+                count[(keys[i] >> shift) & 0xff]++; });
+
+        // Digit-major, chunk-minor prefix sum keeps the sort stable
+        size_t sum = 0;
+        for (size_t d = 0; d < buckets; ++d)
+        {
+            for (size_t c = 0; c < chunks; ++c)
+            {
+                size_t count = offsets[c * buckets + d];
+                offsets[c * buckets + d] = sum;
+                sum += count;
+            }
+        }
+
+        parallel_for(chunks, num_threads, [&](size_t c)
+                     {
+            size_t *next = &offsets[c * buckets];
+            for (size_t i = n * c / chunks; i < n * (c + 1) / chunks; ++i)
+            {
+                size_t pos = next[(keys[i] >> shift) & 0xff]++;
+                keys_out[pos] = keys[i];
+                values_out[pos] = values[i];
+            } });
+        keys.swap(keys_out);
+        values.swap(values_out);
+    }
+}
@@ -13,4 +13,25 @@ public:
     {
         return origin + direction * t;
     }
+};
+
+// Per-ray data for slab tests: inverse direction and direction signs are
+// computed once and reused for every box the ray is tested against
+struct RayPrecomp
+{
+    float origin[3];
+    float inv_dir[3];
+    int sign[3]; // 1 when the direction is negative: the max plane is entered first
+
+    explicit RayPrecomp(const Ray &r)
+    {
+        const float d[3] = {r.direction.x, r.direction.y, r.direction.z};
+        const float o[3] = {r.origin.x, r.origin.y, r.origin.z};
+        for (int a = 0; a < 3; ++a)
+        {
+            origin[a] = o[a];
+            inv_dir[a] = 1.0f / d[a]; // +-inf for axis-parallel rays
+            sign[a] = inv_dir[a] < 0;
+        }
+    }
 };
\ No newline at end of file
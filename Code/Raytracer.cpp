@@ -13,500 +13,144 @@
 #include "Light.hpp"
 #include "Material.hpp"
 #include "utility.hpp"
+#include "SceneParser.hpp"
+#include "TileScheduler.hpp"
+#include "RenderConfig.hpp"
+#include "Accelerator.hpp"
+#include "SphereSet.hpp"
+#include "ImageOutput.hpp"
+#include "Film.hpp"
+#include "Integrators.hpp"
+#include <algorithm>
 #include <chrono>
 #include <thread>
 #include <future>
+#include <filesystem>
 
 using Color = Vec3;
 using json = nlohmann::json;
 
-Color linearToneMapping(const Color &color, float exposure)
-{
-    Color mapped = color * exposure; // Scale based on exposure
-
-    return Color(
-        fmin(mapped.x, 1.0f),
-        fmin(mapped.y, 1.0f),
-        fmin(mapped.z, 1.0f));
-}
-
-Color reinhardToneMapping(const Color &color, float exposure)
+std::future<Camera> async_parseCamera(const json &j)
 {
-    Color mapped = color * exposure; // Scale based on exposure
-
-    return Color(
-        mapped.x / (1.0f + mapped.x),
-        mapped.y / (1.0f + mapped.y),
-        mapped.z / (1.0f + mapped.z));
+    return std::async(std::launch::async, parseCamera, j);
 }
 
-void write_color_withGamma(std::ostream &out, Color pixel_color, int samples_per_pixel, float exposure)
+std::future<hittable_list> async_parseScene(const json &j, const std::string &scene_dir)
 {
-    Color scaled_color = pixel_color / samples_per_pixel;
-
-    Color tone_mapped_color = linearToneMapping(scaled_color, exposure);
-
-    float gamma_correction = 1.0f / 2.2f;
-    auto r = pow(tone_mapped_color.x, gamma_correction);
-    auto g = pow(tone_mapped_color.y, gamma_correction);
-    auto b = pow(tone_mapped_color.z, gamma_correction);
-
-    out << static_cast<int>(256 * clamp(r, 0.0, 0.999)) << ' '
-        << static_cast<int>(256 * clamp(g, 0.0, 0.999)) << ' '
-        << static_cast<int>(256 * clamp(b, 0.0, 0.999)) << '\n';
+    return std::async(std::launch::async, [](const json &j, const std::string &scene_dir)
+                      {
+        hittable_list world;
+        parseScene(j, world, scene_dir);
+        return world; }, j, scene_dir);
 }
 
-void write_color(std::ostream &out, Color pixel_color, int samples_per_pixel, float exposure)
+std::future<std::vector<Light>> async_parseLights(const json &j)
 {
-    auto r = pixel_color.x;
-    auto g = pixel_color.y;
-    auto b = pixel_color.z;
-
-    auto scale = 1.0 / samples_per_pixel;
-    r = sqrt(scale * r);
-    g = sqrt(scale * g);
-    b = sqrt(scale * b);
-
-    out << static_cast<int>(256 * clamp(r, 0.0, 0.999)) << ' '
-        << static_cast<int>(256 * clamp(g, 0.0, 0.999)) << ' '
-        << static_cast<int>(256 * clamp(b, 0.0, 0.999)) << '\n';
+    return std::async(std::launch::async, [](const json &j)
+                      {
+        std::vector<Light> lights;
+        parseLights(j, lights);
+        return lights; }, j);
 }
 
-Camera parseCamera(const json &j)
+// Write every requested output for the averaged radiance. The heatmap is only
+// written for adaptive renders. Paths written are appended to written.
+bool write_outputs(const RenderConfig &config, const std::vector<Color> &radiance, const std::vector<uint32_t> &samples,
+                   int width, int height, float exposure, int num_threads, std::vector<std::string> &written)
 {
-    auto cam_data = j["camera"];
-    return Camera(Vec3(cam_data["position"]),
-                  Vec3(cam_data["lookAt"]),
-                  Vec3(cam_data["upVector"]),
-                  cam_data["fov"].get<float>(),
-                  static_cast<float>(cam_data["width"].get<int>()) / cam_data["height"].get<int>(),
-                  cam_data["exposure"].get<float>(),
-                  cam_data["width"].get<int>(),
-                  cam_data["height"].get<int>());
-}
+    ToneMapping tone_mapping = config.tonemap == "reinhard" ? reinhardToneMapping : linearToneMapping;
 
-void parseLights(const json &j, std::vector<Light> &lights)
-{
-    if (j["scene"].contains("lightsources"))
-    {
-        for (const auto &light : j["scene"]["lightsources"])
-        {
-            Vec3 position(light["position"]);
-            Color intensity(light["intensity"]);
-            lights.emplace_back(position, intensity);
-        }
-    }
-}
+    // One tone-mapping pass for both 8-bit images, skipped when only the HDR image is wanted
+    bool ldr = config.has_format("p3") || config.has_format("p6");
+    bool binary = config.has_format("p6");
+    ToneMappedImages images = tone_map(radiance, width, height, 1, exposure, tone_mapping, ldr, ldr, num_threads);
 
-void parseScene(const json &j, hittable_list &world)
-{
-    for (const auto &obj : j["scene"]["shapes"])
+    if (ldr)
     {
-        std::shared_ptr<Material> material = std::make_shared<Diffuse>(Vec3(1, 0, 0));
-
-        if (obj.contains("material"))
-        {
-            const auto &mat_json = obj["material"];
-            if (mat_json.contains("isrefractive") && mat_json["isrefractive"].get<bool>())
-            {
-                material = std::make_shared<Dielectric>(obj["material"]);
-            }
-            else if (mat_json.contains("isreflective") && mat_json["isreflective"].get<bool>())
-            {
-                material = std::make_shared<Metal>(obj["material"]);
-            }
-            else
-            {
-                material = std::make_shared<Diffuse>(obj["material"]);
-            }
-        }
-        else
-        {
-            material = std::make_shared<Diffuse>(Vec3(1, 0, 0)); // Red Diffuse material
-        }
-
-        if (obj.contains("type") && obj["type"] == "sphere" && obj.contains("center") && obj.contains("radius"))
+        if (!write_ppm(config.linear_output, width, height, images.gamma, binary))
         {
-            world.add(std::make_shared<Sphere>(
-                Vec3(obj["center"]),
-                obj["radius"].get<float>(),
-                material));
+            std::cerr << "Failed to open " << config.linear_output << " for writing.\n";
+            return false;
         }
-        else if (obj.contains("type") && obj["type"] == "cylinder" && obj.contains("center") && obj.contains("axis") &&
-                 obj.contains("radius") && obj.contains("height"))
+        if (!write_ppm(config.normal_output, width, height, images.normal, binary))
         {
-            world.add(std::make_shared<Cylinder>(
-                Vec3(obj["center"]),
-                Vec3(obj["axis"]),
-                obj["radius"].get<float>(),
-                obj["height"].get<float>(),
-                material));
-        }
-        else if (obj.contains("type") && obj["type"] == "triangle" &&
-                 obj.contains("v0") && obj.contains("v1") && obj.contains("v2"))
-        {
-
-            world.add(std::make_shared<Triangle>(
-                Vec3(obj["v0"]),
-                Vec3(obj["v1"]),
-                Vec3(obj["v2"]),
-                material));
+            std::cerr << "Failed to open " << config.normal_output << " for writing.\n";
+            return false;
         }
+        written.push_back(config.normal_output);
+        written.push_back(config.linear_output);
     }
-}
-
-Color Binary_Ray_Color(const Ray &r, const hittable_list &world, const Color &background_color)
-{
-    Hit_record rec;
-    if (world.hit(r, 0.001, inf, rec))
-    {
-        Color lighting(1, 0, 0);
-        return lighting;
-    }
-
-    return background_color;
-}
-Color blinn_phong_shading(const Vec3 &view_dir, const Vec3 &light_dir, const Vec3 &normal, const Material &material, const Color &light_intensity)
-{
-    Color ambient = 0.1 * material.diffusecolor; // Adjust ambient factor as needed
-
-    float diff = std::max(0.0f, normal.dot(light_dir));
-    Color diffuse = diff * material.kd * material.diffusecolor * light_intensity;
-
-    Vec3 halfway_dir = (view_dir + light_dir).normalized();
-    float spec = std::pow(std::max(0.0f, normal.dot(halfway_dir)), material.specularexponent);
-    Color specular = spec * material.ks * material.specularcolor * light_intensity;
-
-    return ambient + diffuse + specular;
-}
-
-// Function to render a range of rows
-
-// Color rayColor_Phong(const Ray &r, const hittable_list &world, const std::vector<Light> &lights, const Color &background_color, int depth)
-// {
-//     if (depth <= 0)
-//         return Color(0, 0, 0);
-
-//     Hit_record rec;
-//     if (world.hit(r, 0.001, inf, rec))
-//     {
-//         Color lighting(0, 0, 0);
-//         Vec3 view_dir = -r.direction.normalized();
-
-//         for (const auto &light : lights)
-//         {
-//             Vec3 light_dir = (light.position - rec.p).normalized();
-//             Ray shadow_ray(rec.p, light_dir);
-//             Hit_record shadow_rec;
-
-//             if (!world.hit(shadow_ray, 0.001, (light.position - rec.p).length(), shadow_rec))
-//             {
-//                 lighting += blinn_phong_shading(view_dir, light_dir, rec.normal, *rec.mat_ptr, light.intensity);
-//             }
-//         }
-
-//         return lighting;
-//     }
-
-//     // Background color
-//     return background_color;
-// }
-
-Color lerp(const Color &a, const Color &b, float t)
-{
-    return a * (1 - t) + b * t;
-}
-
-Color rayColor_Phong(const Ray &r, const hittable_list &world, const std::vector<Light> &lights,
-                     const Color &background_color, int depth)
-{
-    if (depth <= 0)
-        return Color(0, 0, 0);
-
-    Hit_record rec;
-    if (world.hit(r, 0.001, inf, rec))
+    if (config.has_format("pfm"))
     {
-        Color lighting(0, 0, 0); // Please change it to normalize the lighting for phong Shadding I am keeping it 0 0 0 to maximize the effect
-        Vec3 view_dir = -r.direction.normalized();
-
-        for (const auto &light : lights)
+        std::string hdr_output = std::filesystem::path(config.linear_output).replace_extension(".pfm").string();
+        if (!write_pfm(hdr_output, width, height, radiance, 1))
         {
-            Vec3 light_dir = (light.position - rec.p).normalized();
-            Ray shadow_ray(rec.p, light_dir);
-            Hit_record shadow_rec;
-
-            if (!world.hit(shadow_ray, 0.001, (light.position - rec.p).length(), shadow_rec))
-            {
-                lighting += blinn_phong_shading(view_dir, light_dir, rec.normal, *rec.mat_ptr, light.intensity);
-            }
-        }
-
-        if (rec.mat_ptr->isreflective && depth > 0)
-        {
-            Vec3 reflected_dir = reflect(r.direction.normalized(), rec.normal);
-            Ray reflected_ray(rec.p, reflected_dir);
-
-            float cos_theta = std::max(-reflected_dir.dot(rec.normal), 0.0f);
-            float fresnel = rec.mat_ptr->reflectivity + (1.0f - rec.mat_ptr->reflectivity) * std::pow(1.0f - cos_theta, 5);
-
-            Color reflected_color = rayColor_Phong(reflected_ray, world, lights, background_color, depth - 1);
-            lighting = lerp(lighting, reflected_color, fresnel);
+            std::cerr << "Failed to open " << hdr_output << " for writing.\n";
+            return false;
         }
-
-        return lighting;
+        written.push_back(hdr_output);
     }
-
-    return background_color;
-}
-
-Color rayColor(const Ray &r, const hittable_list &world, const std::vector<Light> &lights,
-               const Color &background_color, int depth)
-{
-    if (depth <= 0)
-        return Color(0, 0, 0);
-
-    Hit_record rec;
-    if (world.hit(r, 0.001, inf, rec))
+    if (config.adaptive > 0)
     {
-        Color lighting(0, 0, 0);
-
-        for (const auto &light : lights)
-        {
-            Vec3 light_dir = (light.position - rec.p).normalized();
-            Ray shadow_ray(rec.p, light_dir);
-
-            Hit_record shadow_rec;
-            if (!world.hit(shadow_ray, 0.001, (light.position - rec.p).length(), shadow_rec))
-            {
-                float diff = fmax(0.0, rec.normal.dot(light_dir));
-                Color diffuse = diff * rec.mat_ptr->kd * rec.mat_ptr->diffusecolor * light.intensity;
-
-                Vec3 view_dir = -r.direction.normalized();
-                Vec3 halfway_dir = (light_dir + view_dir).normalized();
-                float spec_angle = fmax(0.0, rec.normal.dot(halfway_dir));
-                float spec = pow(spec_angle, rec.mat_ptr->specularexponent);
-                Color specular = spec * rec.mat_ptr->ks * rec.mat_ptr->specularcolor * light.intensity;
-
-                lighting += diffuse + specular;
-            }
-        }
-
-        Color ambient(0.25, 0.25, 0.25);
-        lighting += ambient * rec.mat_ptr->diffusecolor;
-
-        if (rec.mat_ptr->isreflective && depth > 0)
+        // Samples per pixel, blue for few up to red for the maximum
+        std::filesystem::path heatmap_path(config.linear_output);
+        heatmap_path.replace_filename(heatmap_path.stem().string() + "_spp.ppm");
+        if (!write_ppm(heatmap_path.string(), width, height, sample_heatmap(samples, config.samples_per_pixel), true))
         {
-            Vec3 reflected_dir = reflect(r.direction.normalized(), rec.normal);
-            Ray reflected_ray(rec.p, reflected_dir);
-
-            float cos_theta = fmax(-reflected_dir.dot(rec.normal), 0.0);
-            float fresnel = rec.mat_ptr->reflectivity + (1.0 - rec.mat_ptr->reflectivity) * pow(1.0 - cos_theta, 5);
-
-            Color reflected_color = rayColor(reflected_ray, world, lights, background_color, depth - 1);
-
-            lighting = lerp(lighting, reflected_color, fresnel);
+            std::cerr << "Failed to open " << heatmap_path << " for writing.\n";
+            return false;
         }
-
-        return lighting;
+        written.push_back(heatmap_path.string());
     }
-
-    return background_color;
+    return true;
 }
 
-Color path_tracer_BRDF(const Ray &r, const hittable_list &world, const std::vector<Light> &lights,
-                       const Color &background_color, int depth)
+struct Snapshot
 {
-    if (depth <= 0)
-        return Color(0, 0, 0);
-
-    Hit_record rec;
-    if (world.hit(r, 0.001, inf, rec))
-    {
-        // Emissive component of the material
-        Color emitted = rec.mat_ptr->emit();
-
-        Color lighting(0, 0, 0);          // Contribution from direct lighting
-        Color indirect_lighting(0, 0, 0); // Contribution from indirect lighting (BRDF sampling)
-
-        // Direct lighting calculation
-        for (const auto &light : lights)
-        {
-            Vec3 light_dir = (light.position - rec.p).normalized();
-            Ray shadow_ray(rec.p, light_dir);
+    std::vector<Color> radiance;
+    std::vector<uint32_t> samples;
+    int spp;
+};
 
-            // Shadow check for visibility of the light
-            Hit_record shadow_rec;
-            if (!world.hit(shadow_ray, 0.001, (light.position - rec.p).length(), shadow_rec))
-            {
-                // Lambertian Diffuse Component
-                float diff = fmax(0.0, rec.normal.dot(light_dir));
-                Color diffuse = diff * rec.mat_ptr->kd * rec.mat_ptr->diffusecolor * light.intensity;
-
-                // Blinn-Phong Specular Component
-                Vec3 view_dir = -r.direction.normalized();
-                Vec3 halfway_dir = (light_dir + view_dir).normalized();
-                float spec_angle = fmax(0.0, rec.normal.dot(halfway_dir));
-                float spec = pow(spec_angle, rec.mat_ptr->specularexponent);
-                Color specular = spec * rec.mat_ptr->ks * rec.mat_ptr->specularcolor * light.intensity;
-
-                // Combine diffuse and specular contributions
-                lighting += diffuse + specular;
-            }
-        }
-
-        // Indirect lighting (BRDF sampling)
-        Vec3 attenuation;
-        Ray scattered;
-        if (rec.mat_ptr->scatter(r, rec, attenuation, scattered))
-        {
-            // Recursive call for indirect light sampling
-            indirect_lighting = attenuation * path_tracer_BRDF(scattered, world, lights, background_color, depth - 1);
-        }
-
-        // Combine all components: emitted light, direct lighting, and indirect lighting
-        return emitted + lighting + indirect_lighting;
-    }
-
-    return background_color; // Return background color for rays that miss
-}
-
-Color path_tracer(const Ray &r, const hittable_list &world, const std::vector<Light> &lights,
-                  const Color &background_color, int depth)
+int main(int argc, char *argv[])
 {
-    if (depth <= 0)
-        return Color(0, 0, 0);
-
-    Hit_record rec;
-    if (world.hit(r, 0.001, inf, rec))
+    std::vector<std::string> positional;
+    json flags;
+    std::string error;
+    if (!parse_command_line(argc, argv, positional, flags, error) || flags.contains("help") || positional.empty())
     {
-        Color emitted = rec.mat_ptr->emit();
-
-        Color lighting(0, 0, 0);
-
-        for (const auto &light : lights)
-        {
-            Vec3 light_dir = (light.position - rec.p).normalized();
-            Ray shadow_ray(rec.p, light_dir);
-
-            // Shadow check
-            Hit_record shadow_rec;
-            if (!world.hit(shadow_ray, 0.001, (light.position - rec.p).length(), shadow_rec))
-            {
-                float diff = fmax(0.0, rec.normal.dot(light_dir));
-                Color diffuse = diff * rec.mat_ptr->kd * rec.mat_ptr->diffusecolor * light.intensity;
-
-                Vec3 view_dir = -r.direction.normalized();
-                Vec3 halfway_dir = (light_dir + view_dir).normalized();
-                float spec_angle = fmax(0.0, rec.normal.dot(halfway_dir));
-                float spec = pow(spec_angle, rec.mat_ptr->specularexponent);
-                Color specular = spec * rec.mat_ptr->ks * rec.mat_ptr->specularcolor * light.intensity;
-
-                lighting += diffuse + specular;
-            }
-        }
-
-        Color ambient(0.25, 0.25, 0.25); // This can be tweaked or passed as a scene parameter
-        lighting += ambient * rec.mat_ptr->diffusecolor;
-
-        if (rec.mat_ptr->isreflective && depth > 0)
-        {
-            Vec3 reflected_dir = reflect(r.direction.normalized(), rec.normal);
-            Ray reflected_ray(rec.p, reflected_dir);
-
-            float cos_theta = fmax(-reflected_dir.dot(rec.normal), 0.0);
-            float fresnel = rec.mat_ptr->reflectivity + (1.0 - rec.mat_ptr->reflectivity) * pow(1.0 - cos_theta, 5);
-
-            Color reflected_color = path_tracer(reflected_ray, world, lights, background_color, depth - 1);
-
-            lighting = lerp(lighting, reflected_color, fresnel);
-        }
-
-        return emitted + lighting;
+        if (!error.empty())
+            std::cerr << error << "\n";
+        std::cerr << render_usage();
+        return flags.contains("help") ? 0 : 1;
     }
 
-    return background_color;
-}
+    RenderConfig config;
+    config.scene_path = positional[0];
+    if (positional.size() > 1)
+        config.normal_output = positional[1];
+    if (positional.size() > 2)
+        config.linear_output = positional[2];
 
-void render_rows(int start_y, int end_y, std::vector<Color> &framebuffer, Camera &camera, const hittable_list &world,
-                 const std::vector<Light> &lights, const Color &background_color, int width, int height,
-                 int samples_per_pixel, int max_depth, int TraceType)
-{
-    for (int y = start_y; y < end_y; ++y)
+    std::ifstream file(config.scene_path);
+    if (!file)
     {
-        for (int x = 0; x < width; ++x)
-        {
-            Color pixel_color(0, 0, 0);
-            for (int s = 0; s < samples_per_pixel; ++s)
-            {
-                // std::cout << "x : " << x << " y : " << y << " s : " << s << std::endl;
-                float u = (x + random_double()) / (width - 1);
-                float v = (y + random_double()) / (height - 1);
-                Ray ray = camera.get_ray(u, v);
-
-                if (TraceType == 1)
-                {
-                    pixel_color += Binary_Ray_Color(ray, world, background_color);
-                }
-                else if (TraceType == 2)
-                {
-                    pixel_color += rayColor_Phong(ray, world, lights, background_color, max_depth);
-                }
-                else if (TraceType == 3)
-                {
-                    pixel_color += rayColor(ray, world, lights, background_color, max_depth);
-                }
-                else if (TraceType == 4)
-                {
-                    pixel_color += path_tracer(ray, world, lights, background_color, max_depth);
-                }
-                else
-                {
-                    pixel_color += path_tracer_BRDF(ray, world, lights, background_color, max_depth);
-                }
-            }
-            framebuffer[y * width + x] = pixel_color;
-        }
+        std::cerr << "Failed to open " << config.scene_path << "\n";
+        return 1;
     }
-}
-
-std::future<Camera> async_parseCamera(const json &j)
-{
-    return std::async(std::launch::async, parseCamera, j);
-}
-
-std::future<hittable_list> async_parseScene(const json &j)
-{
-    return std::async(std::launch::async, [](const json &j)
-                      {
-        hittable_list world;
-        parseScene(j, world);
-        return world; }, j);
-}
-
-std::future<std::vector<Light>> async_parseLights(const json &j)
-{
-    return std::async(std::launch::async, [](const json &j)
-                      {
-        std::vector<Light> lights;
-        parseLights(j, lights);
-        return lights; }, j);
-}
+    json j;
+    file >> j;
 
-int main(int argc, char *argv[])
-{
-    if (argc < 2)
+    // Scene "render" block first, command-line flags override it
+    if ((j.contains("render") && !config.apply(j["render"], error)) || !config.apply(flags, error))
     {
-        std::cerr << "Please provide a JSON file as input." << std::endl;
+        std::cerr << error << "\n"
+                  << render_usage();
         return 1;
     }
-    std::cout << argv[2] << std::endl;
-
-    std::ifstream file(argv[1]);
-    json j;
-    file >> j;
 
     auto camera_future = async_parseCamera(j);
-    auto scene_future = async_parseScene(j);
+    auto scene_future = async_parseScene(j, std::filesystem::path(config.scene_path).parent_path().string());
     auto lights_future = async_parseLights(j);
 
     Camera camera = camera_future.get();
@@ -515,73 +159,178 @@ int main(int argc, char *argv[])
 
     Color background_color = j["scene"].contains("backgroundcolor") ? Color(j["scene"]["backgroundcolor"]) : Color(0.25, 0.25, 0.25);
 
-    // hittable_list world;
-    // parseScene(j, world);
-    std::cout << "Press 1 for binary Trace,2 for Bling Phong effect,  3 for Normal, 4 for path Tracing 5 for path Tracing with BRDF sampling: ";
-    int TraceType;
-    std::cin >> TraceType;
+    int num_threads = config.threads > 0 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    // Before packing, which replaces the spheres
+    std::vector<Emitter> emitters = collect_emitters(world.objects);
+    if (config.spheres == "packed")
+        world.objects = pack_spheres(world.objects);
+
+    // Acceleration structure the integrators trace against
+    BVHBuildOptions bvh_options;
+    bvh_options.threads = num_threads;
+    auto build_start = std::chrono::high_resolution_clock::now();
+    shared_ptr<Hittable> accel = make_accelerator(world.objects, config.accel, config.bvh_builder, bvh_options);
+    std::chrono::duration<double> build_time = std::chrono::high_resolution_clock::now() - build_start;
+    const Hittable &scene_root = accel ? *accel : static_cast<const Hittable &>(world);
+    if (accel)
+    {
+        std::cout << "Built " << config.accel << " (" << config.bvh_builder << ") over " << world.objects.size()
+                  << " objects in " << build_time.count() << " seconds";
+        if (auto binary = std::dynamic_pointer_cast<LinearBVH>(accel))
+            std::cout << ", SAH cost " << binary->tree.sah_cost(bvh_options);
+        std::cout << "\n";
+    }
 
+    int TraceType = config.integrator;
     int width = j["camera"]["width"];
     int height = j["camera"]["height"];
-    int samples_per_pixel = 10;
-    int max_depth = 5;
-    std::vector<Color> framebuffer(width * height);
-    int num_threads = std::thread::hardware_concurrency();
-    int rows_per_thread = height / num_threads;
-    std::cout << "Num of Threads : " << num_threads << " Rows per thread: " << rows_per_thread << std::endl;
-    auto start = std::chrono::high_resolution_clock::now();
-
-    // Launch threads
-    std::vector<std::thread> threads;
-    for (int i = 0; i < num_threads; ++i)
+    int samples_per_pixel = config.samples_per_pixel;
+    int max_depth = config.max_depth;
+    uint64_t seed = config.seed;
+    Film film(width, height, seed);
+    SamplerType sampler = config.sampler == "sobol"       ? SamplerType::Sobol
+                          : config.sampler == "bluenoise" ? SamplerType::BlueNoise
+                                                          : SamplerType::Random;
+    CheckpointHeader checkpoint_header;
+    checkpoint_header.width = width;
+    checkpoint_header.height = height;
+    checkpoint_header.seed = seed;
+    checkpoint_header.integrator = TraceType;
+    checkpoint_header.max_depth = max_depth;
+    checkpoint_header.sampler = static_cast<int32_t>(sampler);
+    if (!config.resume.empty())
     {
-        int start_y = i * rows_per_thread;
-        int end_y = (i == num_threads - 1) ? height : (i + 1) * rows_per_thread;
-        threads.emplace_back(render_rows, start_y, end_y, std::ref(framebuffer), std::ref(camera), std::cref(world),
-                             std::cref(lights), background_color, width, height, samples_per_pixel, max_depth, TraceType);
+        CheckpointHeader saved;
+        if (!load_checkpoint(config.resume, film, saved, error))
+        {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        if (saved.width != width || saved.height != height || saved.seed != seed || saved.integrator != TraceType ||
+            saved.max_depth != max_depth || saved.sampler != checkpoint_header.sampler)
+        {
+            std::cerr << "Checkpoint " << config.resume
+                      << " was rendered with a different resolution, seed, integrator, depth or sampler\n";
+            return 1;
+        }
+        std::cout << "Resuming from " << config.resume << " at " << *std::min_element(film.samples.begin(), film.samples.end())
+                  << " spp\n";
     }
+    SampleContext ctx{camera, scene_root, lights, emitters, background_color, width, height, max_depth, TraceType, sampler, seed};
+    bool adaptive = config.adaptive > 0;
+    int tile_size = config.tile_size;
+    TileScheduler scheduler(width, height, tile_size);
+    std::cout << "Integrator: " << RenderConfig::integrator_name(TraceType) << ", " << samples_per_pixel << " spp";
+    if (adaptive)
+        std::cout << " max (adaptive, " << config.min_samples << " min, error " << config.adaptive << ")";
+    std::cout << ", depth " << max_depth << ", seed " << seed << ", sampler " << config.sampler << ", accel "
+              << config.accel << std::endl;
+    std::cout << "Num of Threads : " << num_threads << " Tiles: " << scheduler.tile_count() << " of "
+              << tile_size << "x" << tile_size << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
 
-    // Join threads
-    for (auto &thread : threads)
+    auto render_pass = [&](int pass_spp)
+    {
+        // Threads pull tiles until none are left
+        scheduler.reset();
+        return run_tiles(scheduler, num_threads, [&](const Tile &tile)
+                         {
+            if (adaptive)
+                render_tile_adaptive(tile, film, ctx, config.min_samples, pass_spp, config.adaptive);
+            else
+                render_tile(tile, film, ctx, pass_spp); });
+    };
+
+    std::vector<ThreadStats> stats;
+    bool checkpointing = !config.checkpoint.empty();
+    bool progressive = config.time_budget > 0 || config.snapshot_interval > 0 || checkpointing || !config.resume.empty();
+    if (!progressive)
+        stats = render_pass(samples_per_pixel);
+    else
     {
-        thread.join();
+        // Whole-image passes of doubling spp. A pass is shortened so it should
+        // end within the time budget and the snapshot and checkpoint intervals,
+        // the render stops when no pass fits the budget, and snapshots and
+        // checkpoints are handed to writer threads whenever their interval has
+        // passed. A resumed render starts at the fewest samples of any pixel.
+        float exposure = j["camera"]["exposure"];
+        SnapshotWriter<Snapshot> writer([&](const Snapshot &snapshot)
+                                        {
+            std::vector<std::string> paths;
+            if (write_outputs(config, snapshot.radiance, snapshot.samples, width, height, exposure, 1, paths))
+                std::cout << "Snapshot at " << snapshot.spp << " spp" << std::endl; });
+        SnapshotWriter<Film> checkpoint_writer([&](const Film &state)
+                                               {
+            if (!save_checkpoint(config.checkpoint, state, checkpoint_header))
+                std::cerr << "Failed to write checkpoint " << config.checkpoint << "\n"; });
+        auto last_snapshot = start, last_checkpoint = start;
+        double pass_limit = config.snapshot_interval;
+        if (checkpointing && (pass_limit == 0 || config.checkpoint_interval < pass_limit))
+            pass_limit = config.checkpoint_interval;
+        double seconds_per_spp = 0;
+        int spp = static_cast<int>(*std::min_element(film.samples.begin(), film.samples.end()));
+        for (int pass_spp = 1; spp < samples_per_pixel; pass_spp *= 2)
+        {
+            int n = std::min(pass_spp, samples_per_pixel - spp);
+            if (config.time_budget > 0)
+            {
+                std::chrono::duration<double> used = std::chrono::high_resolution_clock::now() - start;
+                double remaining = config.time_budget - used.count();
+                if (remaining <= 0 || remaining < seconds_per_spp)
+                    break;
+                if (seconds_per_spp > 0)
+                    n = std::min(n, static_cast<int>(remaining / seconds_per_spp));
+            }
+            if (pass_limit > 0 && seconds_per_spp > 0)
+                n = std::min(n, std::max(1, static_cast<int>(pass_limit / seconds_per_spp)));
+            auto pass_start = std::chrono::high_resolution_clock::now();
+            stats = render_pass(spp + n);
+            auto pass_end = std::chrono::high_resolution_clock::now();
+            seconds_per_spp = std::chrono::duration<double>(pass_end - pass_start).count() / n;
+            spp += n;
+
+            if (config.snapshot_interval > 0 && spp < samples_per_pixel &&
+                std::chrono::duration<double>(pass_end - last_snapshot).count() >= config.snapshot_interval)
+            {
+                writer.submit({film.resolve(), film.samples, spp});
+                last_snapshot = pass_end;
+            }
+            if (checkpointing && spp < samples_per_pixel &&
+                std::chrono::duration<double>(pass_end - last_checkpoint).count() >= config.checkpoint_interval)
+            {
+                checkpoint_writer.submit(film);
+                last_checkpoint = pass_end;
+            }
+        }
+        writer.finish();
+        checkpoint_writer.finish();
+        if (checkpointing && !save_checkpoint(config.checkpoint, film, checkpoint_header))
+        {
+            std::cerr << "Failed to write checkpoint " << config.checkpoint << "\n";
+            return 1;
+        }
+        std::cout << "Progressive: " << spp << " of " << samples_per_pixel << " spp\n";
     }
 
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = end - start;
     std::cout << "Render Time: " << elapsed.count() << " seconds\n";
-
-    std::ofstream out1(argv[3]);
-    if (!out1)
-    {
-        std::cerr << "Failed to open " << argv[2] << " for writing.\n";
+    print_thread_stats(stats);
+    if (adaptive)
+        std::cout << "Average spp: " << double(film.total_samples()) / film.pixel_count() << "\n";
+
+    float exposure = j["camera"]["exposure"];
+    start = std::chrono::high_resolution_clock::now();
+    std::vector<std::string> written;
+    if (!write_outputs(config, film.resolve(), film.samples, width, height, exposure, num_threads, written))
         return 1;
-    }
-    out1 << "P3\n"
-         << width << ' ' << height << "\n255\n";
-
-    for (const Color &color : framebuffer)
-    {
-        write_color_withGamma(out1, color, samples_per_pixel, j["camera"]["exposure"]);
-    }
+    elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Output Time: " << elapsed.count() << " seconds\n";
 
-    out1.close();
-
-    std::ofstream out(argv[2]);
-    if (!out)
-    {
-        std::cerr << "Failed to open " << argv[2] << " for writing.\n";
-        return 1;
-    }
-    out << "P3\n"
-        << width << ' ' << height << "\n255\n";
-
-    for (const Color &color : framebuffer)
-    {
-        write_color(out, color, samples_per_pixel, j["camera"]["exposure"]);
-    }
-    out.close();
-
-    std::cout << "Rendering complete. Image saved to 'output.ppm'" << std::endl;
+    std::cout << "Rendering complete. Images saved to";
+    for (const std::string &path : written)
+        std::cout << ' ' << path;
+    std::cout << std::endl;
     return 0;
-}
\ No newline at end of file
+}
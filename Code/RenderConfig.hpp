@@ -0,0 +1,290 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sstream>
+#include <algorithm>
+#include "json/include/nlohmann/json.hpp"
+
+// Render settings. Defaults are overridden by the scene's optional "render"
+// block, which is overridden by command-line flags. Both use the same keys,
+// e.g. "spp": 64 in JSON and --spp 64 on the command line.
+struct RenderConfig
+{
+    std::string scene_path;
+    std::string normal_output = "scene_normal.ppm";
+    std::string linear_output = "scene_linear.ppm";
+
+    int integrator = 5; // 1 binary, 2 phong, 3 normal, 4 path, 5 brdf
+    int samples_per_pixel = 10; // the maximum with adaptive sampling
+    double adaptive = 0;        // relative error target per pixel, 0 = same spp everywhere
+    int min_samples = 4;        // adaptive: first pass and batch size
+    double time_budget = 0;      // progressive: stop after this many seconds, 0 = at spp
+    double snapshot_interval = 0; // progressive: seconds between intermediate outputs, 0 = none
+    std::string checkpoint;            // progressive: file the render state is saved to
+    double checkpoint_interval = 60;   // seconds between checkpoints
+    std::string resume;                // checkpoint to continue from
+    int max_depth = 5;
+    int threads = 0; // 0 = one per hardware thread
+    int tile_size = 32;
+    uint64_t seed = 1;
+    std::string tonemap = "linear";  // linear | reinhard, used for the gamma-corrected image
+    std::string accel = "bvh";       // list | bvh | bvh4 | bvh8
+    std::string bvh_builder = "sah"; // sah | lbvh | median
+    std::string spheres = "objects"; // objects | packed into one SIMD SphereSet
+    std::string sampler = "random";  // random | sobol | bluenoise
+    std::vector<std::string> formats = {"p3"}; // p3 | p6 8-bit images, pfm HDR radiance
+
+    // Apply every known key of settings, false with a message on a bad value or unknown key
+    bool apply(const nlohmann::json &settings, std::string &error)
+    {
+        if (!settings.is_object())
+        {
+            error = "render settings must be a JSON object";
+            return false;
+        }
+        try
+        {
+            for (const auto &item : settings.items())
+            {
+                const std::string &key = item.key();
+                const nlohmann::json &value = item.value();
+                if (key == "integrator")
+                {
+                    if (!parse_integrator(value, integrator))
+                        return fail(error, key, value);
+                }
+                else if (key == "spp")
+                    samples_per_pixel = value.get<int>();
+                else if (key == "adaptive")
+                    adaptive = value.get<double>();
+                else if (key == "min_spp")
+                    min_samples = value.get<int>();
+                else if (key == "time")
+                    time_budget = value.get<double>();
+                else if (key == "snapshot")
+                    snapshot_interval = value.get<double>();
+                else if (key == "checkpoint")
+                    checkpoint = value.get<std::string>();
+                else if (key == "checkpoint_interval")
+                    checkpoint_interval = value.get<double>();
+                else if (key == "resume")
+                    resume = value.get<std::string>();
+                else if (key == "depth")
+                    max_depth = value.get<int>();
+                else if (key == "threads")
+                    threads = value.get<int>();
+                else if (key == "tile")
+                    tile_size = value.get<int>();
+                else if (key == "seed")
+                    seed = value.get<uint64_t>();
+                else if (key == "tonemap")
+                {
+                    if (!one_of(value, {"linear", "reinhard"}, tonemap))
+                        return fail(error, key, value);
+                }
+                else if (key == "accel")
+                {
+                    if (!one_of(value, {"list", "bvh", "bvh4", "bvh8"}, accel))
+                        return fail(error, key, value);
+                }
+                else if (key == "bvh_builder")
+                {
+                    if (!one_of(value, {"sah", "lbvh", "median"}, bvh_builder))
+                        return fail(error, key, value);
+                }
+                else if (key == "sampler")
+                {
+                    if (!one_of(value, {"random", "sobol", "bluenoise"}, sampler))
+                        return fail(error, key, value);
+                }
+                else if (key == "spheres")
+                {
+                    if (!one_of(value, {"objects", "packed"}, spheres))
+                        return fail(error, key, value);
+                }
+                else if (key == "format")
+                {
+                    if (!parse_formats(value, formats))
+                        return fail(error, key, value);
+                }
+                else
+                {
+                    error = "unknown render setting '" + key + "'";
+                    return false;
+                }
+            }
+        }
+        catch (const nlohmann::json::exception &)
+        {
+            error = "render settings have a value of the wrong type";
+            return false;
+        }
+
+        if (samples_per_pixel < 1 || max_depth < 1 || threads < 0 || tile_size < 1 || min_samples < 2 || adaptive < 0 ||
+            time_budget < 0 || snapshot_interval < 0 || checkpoint_interval < 0)
+        {
+            error = "spp, depth and tile must be positive, min_spp at least 2, threads, adaptive, time and snapshot non-negative";
+            return false;
+        }
+        return true;
+    }
+
+    bool has_format(const std::string &format) const
+    {
+        return std::find(formats.begin(), formats.end(), format) != formats.end();
+    }
+
+    static const char *integrator_name(int integrator)
+    {
+        static const char *names[] = {"binary", "phong", "normal", "path", "brdf"};
+        return names[std::min(std::max(integrator, 1), 5) - 1];
+    }
+
+    static const std::vector<std::string> &known_formats()
+    {
+        static const std::vector<std::string> formats = {"p3", "p6", "pfm"};
+        return formats;
+    }
+
+private:
+    static bool fail(std::string &error, const std::string &key, const nlohmann::json &value)
+    {
+        error = "invalid value " + value.dump() + " for '" + key + "'";
+        return false;
+    }
+
+    static bool one_of(const nlohmann::json &value, std::initializer_list<const char *> options, std::string &out)
+    {
+        if (!value.is_string())
+            return false;
+        for (const char *option : options)
+        {
+            if (value.get<std::string>() == option)
+            {
+                out = option;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool parse_integrator(const nlohmann::json &value, int &out)
+    {
+        if (value.is_number_integer())
+        {
+            int n = value.get<int>();
+            if (n < 1 || n > 5)
+                return false;
+            out = n;
+            return true;
+        }
+        if (!value.is_string())
+            return false;
+        for (int n = 1; n <= 5; ++n)
+        {
+            if (value.get<std::string>() == integrator_name(n))
+            {
+                out = n;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Accepts ["p3", ...] or a comma-separated string
+    static bool parse_formats(const nlohmann::json &value, std::vector<std::string> &out)
+    {
+        std::vector<std::string> parsed;
+        if (value.is_string())
+        {
+            std::stringstream ss(value.get<std::string>());
+            std::string item;
+            while (std::getline(ss, item, ','))
+                parsed.push_back(item);
+        }
+        else if (value.is_array())
+        {
+            for (const auto &item : value)
+                parsed.push_back(item.get<std::string>());
+        }
+
+        const auto &known = known_formats();
+        for (const auto &format : parsed)
+        {
+            if (std::find(known.begin(), known.end(), format) == known.end())
+                return false;
+        }
+        // p3 and p6 would write the same files
+        bool p3 = std::find(parsed.begin(), parsed.end(), "p3") != parsed.end();
+        bool p6 = std::find(parsed.begin(), parsed.end(), "p6") != parsed.end();
+        if (parsed.empty() || (p3 && p6))
+            return false;
+        out = parsed;
+        return true;
+    }
+};
+
+// Split argv into positional arguments and --key value flags. Flag values are
+// read as JSON when they parse (numbers), otherwise kept as strings, and '-'
+// in flag names becomes '_' so --bvh-builder matches the JSON key bvh_builder.
+inline bool parse_command_line(int argc, char *argv[], std::vector<std::string> &positional,
+                               nlohmann::json &flags, std::string &error)
+{
+    flags = nlohmann::json::object();
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0)
+        {
+            positional.push_back(arg);
+            continue;
+        }
+
+        std::string key = arg.substr(2);
+        if (key == "help")
+        {
+            flags["help"] = true;
+            continue;
+        }
+        std::replace(key.begin(), key.end(), '-', '_');
+        if (i + 1 >= argc)
+        {
+            error = "missing value for " + arg;
+            return false;
+        }
+        std::string value = argv[++i];
+        nlohmann::json parsed = nlohmann::json::parse(value, nullptr, false);
+        flags[key] = parsed.is_number() ? parsed : nlohmann::json(value);
+    }
+    return true;
+}
+
+inline const char *render_usage()
+{
+    return "Usage: Raytracer <scene.json> [normal-output] [linear-output] [options]\n"
+           "  --integrator binary|phong|normal|path|brdf   (or 1-5, default brdf)\n"
+           "  --spp N            samples per pixel (default 10)\n"
+           "  --adaptive E       sample until the relative error of a pixel is below E, with --spp\n"
+           "                     as the maximum; writes a samples-per-pixel heatmap (default 0 = off)\n"
+           "  --min-spp N        adaptive: first pass and batch size in samples (default 4)\n"
+           "  --time S           progressive: render passes of doubling spp until --spp or S seconds\n"
+           "  --snapshot S       progressive: rewrite the outputs every S seconds while rendering\n"
+           "  --checkpoint FILE  progressive: save the render state to FILE periodically and at the end\n"
+           "  --checkpoint-interval S   seconds between checkpoints (default 60)\n"
+           "  --resume FILE      continue a render from a checkpoint; the result matches an\n"
+           "                     uninterrupted render with the same settings\n"
+           "  --depth N          maximum path depth (default 5)\n"
+           "  --sampler random|sobol|bluenoise   pixel, lens and diffuse bounce samples (default random)\n"
+           "  --threads N        render threads, 0 = all hardware threads (default 0)\n"
+           "  --tile N           tile size in pixels (default 32)\n"
+           "  --seed N           random seed (default 1)\n"
+           "  --format LIST      comma-separated output formats (default p3):\n"
+           "                     p3 ASCII / p6 binary PPM images, pfm float radiance next to\n"
+           "                     linear-output with a .pfm extension; pfm alone skips tone mapping\n"
+           "  --tonemap linear|reinhard\n"
+           "  --accel list|bvh|bvh4|bvh8   (default bvh)\n"
+           "  --bvh-builder sah|lbvh|median   (default sah)\n"
+           "  --spheres objects|packed   packed tests spheres 4-16 at a time with SIMD (default objects)\n"
+           "The same keys can be set in a \"render\" object in the scene JSON.\n";
+}
@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Defined in utility.hpp, which includes this header
+inline double random_double();
+
+// Where the pixel, lens and BSDF dimensions of a camera sample come from.
+//   Random:    independent PCG32 numbers from the pixel's generator
+//   Sobol:     Owen-scrambled Sobol (0,2)-sequence per pair of dimensions, with
+//              the sample index shuffled and the points scrambled per pixel
+//              and dimension (Burley 2020), so dimensions stay decorrelated
+//   BlueNoise: one Owen-scrambled Sobol sequence for the whole image, shifted
+//              per pixel by a blue-noise mask (Georgiev and Fajardo 2016), so
+//              the remaining error is spread as high-frequency noise
+// Other random decisions (Russian roulette, Fresnel, glossy fuzz) always use
+// the pixel's generator.
+enum class SamplerType
+{
+    Random,
+    Sobol,
+    BlueNoise
+};
+
+// State of the camera sample being traced on this thread
+struct PixelSample
+{
+    SamplerType type = SamplerType::Random;
+    uint64_t seed = 0;
+    uint32_t x = 0, y = 0;
+    uint32_t index = 0;     // sample number within the pixel
+    uint32_t dimension = 0; // next dimension handed out
+};
+
+inline PixelSample &thread_pixel_sample()
+{
+    thread_local PixelSample sample;
+    return sample;
+}
+
+inline void start_pixel_sample(SamplerType type, uint64_t seed, uint32_t x, uint32_t y, uint32_t index)
+{
+    thread_pixel_sample() = PixelSample{type, seed, x, y, index, 0};
+}
+
+namespace sampler
+{
+    inline uint32_t reverse_bits(uint32_t x)
+    {
+        x = (x << 16) | (x >> 16);
+        x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+        x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+        x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+        x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+        return x;
+    }
+
+    inline uint32_t hash(uint64_t a, uint64_t b)
+    {
+        uint64_t h = a * 0x9e3779b97f4a7c15ULL ^ (b + 0x632be59bd9b4e019ULL);
+        h ^= h >> 31;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return static_cast<uint32_t>(h);
+    }
+
+    // Owen scrambling of a 32-bit fraction through the Laine-Karras hash on the reversed bits
+    inline uint32_t owen_scramble(uint32_t x, uint32_t seed)
+    {
+        x = reverse_bits(x);
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return reverse_bits(x);
+    }
+
+    // First two Sobol dimensions: van der Corput and its Sobol partner
+    inline uint32_t sobol(uint32_t index, int axis)
+    {
+        if (axis == 0)
+            return reverse_bits(index);
+        uint32_t result = 0;
+        for (uint32_t v = 1u << 31; index; index >>= 1, v ^= v >> 1)
+        {
+            if (index & 1)
+                result ^= v;
+        }
+        return result;
+    }
+
+    // 64 x 64 blue-noise mask of ranks 0..4095 built once by void-and-cluster
+    // (Ulichney 1993) with a toroidal Gaussian energy of sigma 1.5
+    inline const std::vector<uint16_t> &blue_noise_mask()
+    {
+        static const std::vector<uint16_t> mask = []
+        {
+            const int n = 64, size = n * n;
+            std::vector<float> kernel(size);
+            for (int y = 0; y < n; ++y)
+            {
+                for (int x = 0; x < n; ++x)
+                {
+                    int dx = std::min(x, n - x), dy = std::min(y, n - y);
+                    kernel[y * n + x] = std::exp(-(dx * dx + dy * dy) / (2 * 1.5f * 1.5f));
+                }
+            }
+            std::vector<uint8_t> on(size, 0);
+            std::vector<float> energy(size, 0);
+            auto toggle = [&](int p, float sign)
+            {
+                int px = p % n, py = p / n;
+                for (int y = 0; y < n; ++y)
+                {
+                    for (int x = 0; x < n; ++x)
+                        energy[y * n + x] += sign * kernel[((y - py + n) % n) * n + (x - px + n) % n];
+                }
+            };
+            // Tightest cluster: the set point with the most energy; largest void: the free one with the least
+            auto extreme = [&](uint8_t state)
+            {
+                int best = -1;
+                for (int p = 0; p < size; ++p)
+                {
+                    if (on[p] == state && (best < 0 || (state ? energy[p] > energy[best] : energy[p] < energy[best])))
+                        best = p;
+                }
+                return best;
+            };
+
+            // Initial pattern: 10% random points, relaxed until moving the
+            // tightest cluster into the largest void no longer changes anything
+            int initial = size / 10;
+            for (uint32_t draw = 0, placed = 0; static_cast<int>(placed) < initial; ++draw)
+            {
+                int p = static_cast<int>(hash(12345, draw) % size);
+                if (!on[p])
+                {
+                    on[p] = 1;
+                    toggle(p, 1);
+                    ++placed;
+                }
+            }
+            for (int step = 0; step < size; ++step)
+            {
+                int cluster = extreme(1);
+                on[cluster] = 0;
+                toggle(cluster, -1);
+                int hole = extreme(0);
+                on[hole] = 1;
+                toggle(hole, 1);
+                if (hole == cluster)
+                    break;
+            }
+
+            std::vector<uint16_t> rank(size);
+            std::vector<uint8_t> initial_on = on;
+            std::vector<float> initial_energy = energy;
+            // Rank the initial points from the last removed downwards...
+            for (int r = initial - 1; r >= 0; --r)
+            {
+                int cluster = extreme(1);
+                on[cluster] = 0;
+                toggle(cluster, -1);
+                rank[cluster] = static_cast<uint16_t>(r);
+            }
+            // ...then fill the largest voids upwards
+            on = initial_on;
+            energy = initial_energy;
+            for (int r = initial; r < size; ++r)
+            {
+                int hole = extreme(0);
+                on[hole] = 1;
+                toggle(hole, 1);
+                rank[hole] = static_cast<uint16_t>(r);
+            }
+            return rank;
+        }();
+        return mask;
+    }
+
+    inline double to_unit(uint32_t x)
+    {
+        return x * (1.0 / 4294967296.0);
+    }
+}
+
+// Next dimension of the current camera sample in [0, 1). Dimensions come in
+// pairs that share one shuffled Sobol index, so each pair is a (0,2)-net.
+inline double sample_1d()
+{
+    PixelSample &s = thread_pixel_sample();
+    if (s.type == SamplerType::Random)
+        return random_double();
+
+    uint32_t dimension = s.dimension++;
+    uint32_t pair = dimension / 2;
+    int axis = dimension % 2;
+    // Sobol scrambles per pixel; blue noise uses the same points everywhere
+    uint64_t scramble_seed = s.seed;
+    if (s.type == SamplerType::Sobol)
+        scramble_seed = sampler::hash(s.seed, (static_cast<uint64_t>(s.y) << 32) | s.x);
+    uint32_t index = sampler::owen_scramble(s.index, sampler::hash(scramble_seed, pair));
+    uint32_t value = sampler::owen_scramble(sampler::sobol(index, axis), sampler::hash(scramble_seed, 0x100000000ULL + dimension));
+    if (s.type == SamplerType::Sobol)
+        return sampler::to_unit(value);
+
+    // Toroidal shift by the mask, read at a per-dimension offset; rank / 4096 as a 32-bit fraction
+    uint32_t offset = sampler::hash(s.seed, 0x200000000ULL + dimension);
+    uint32_t mx = (s.x + offset) & 63, my = (s.y + (offset >> 6)) & 63;
+    uint32_t shift = static_cast<uint32_t>(sampler::blue_noise_mask()[my * 64 + mx]) << 20;
+    return sampler::to_unit(value + shift);
+}
+
+inline bool low_discrepancy_sampling()
+{
+    return thread_pixel_sample().type != SamplerType::Random;
+}
@@ -45,6 +45,17 @@ public:
         return hit_anything;
     }
 
+    // Check whether anything blocks the segment, without building a hit record
+    bool occluded(const Ray &r, double t_min, double t_max) const
+    {
+        for (const auto &object : objects)
+        {
+            if (object->occluded(r, t_min, t_max))
+                return true;
+        }
+        return false;
+    }
+
     // Access lights in the scene
     const std::vector<Light> &getLights() const
     {
@@ -0,0 +1,169 @@
+#pragma once
+#include "json/include/nlohmann/json.hpp"
+#include <vector>
+#include <memory>
+#include "Camera.hpp"
+#include "Cylinder.hpp"
+#include "Sphere.hpp"
+#include "Triangle.hpp"
+#include "TriangleMesh.hpp"
+#include "Instance.hpp"
+#include "MeshLoader.hpp"
+#include "HitRecord.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+
+using json = nlohmann::json;
+
+Camera parseCamera(const json &j)
+{
+    auto cam_data = j["camera"];
+    return Camera(Vec3(cam_data["position"]),
+                  Vec3(cam_data["lookAt"]),
+                  Vec3(cam_data["upVector"]),
+                  cam_data["fov"].get<float>(),
+                  static_cast<float>(cam_data["width"].get<int>()) / cam_data["height"].get<int>(),
+                  cam_data["exposure"].get<float>(),
+                  cam_data["width"].get<int>(),
+                  cam_data["height"].get<int>());
+}
+
+void parseLights(const json &j, std::vector<Light> &lights)
+{
+    if (j["scene"].contains("lightsources"))
+    {
+        for (const auto &light : j["scene"]["lightsources"])
+        {
+            Vec3 position(light["position"]);
+            Color intensity(light["intensity"]);
+            lights.emplace_back(position, intensity);
+        }
+    }
+}
+
+std::shared_ptr<Material> parseMaterial(const json &mat_json)
+{
+    if (mat_json.contains("isrefractive") && mat_json["isrefractive"].get<bool>())
+        return std::make_shared<Dielectric>(mat_json);
+    if (mat_json.contains("isreflective") && mat_json["isreflective"].get<bool>())
+        return std::make_shared<Metal>(mat_json);
+    return std::make_shared<Diffuse>(mat_json);
+}
+
+// Instance placement: scale, then rotate by "rotate" degrees around x, y and z
+// in that order, then "translate". "scale" is a number or a per-axis array.
+Transform parseTransform(const json &j)
+{
+    Transform x;
+    if (j.contains("scale"))
+        x = Transform::scale(j["scale"].is_number() ? Vec3(1, 1, 1) * j["scale"].get<float>() : Vec3(j["scale"]));
+    if (j.contains("rotate"))
+    {
+        Vec3 degrees(j["rotate"]);
+        x = Transform::rotate(Vec3(1, 0, 0), degrees.x) * x;
+        x = Transform::rotate(Vec3(0, 1, 0), degrees.y) * x;
+        x = Transform::rotate(Vec3(0, 0, 1), degrees.z) * x;
+    }
+    if (j.contains("translate"))
+        x = Transform::translate(Vec3(j["translate"])) * x;
+    return x;
+}
+
+// Relative mesh file paths are resolved against scene_dir, the directory of the scene JSON
+void parseScene(const json &j, hittable_list &world, const std::string &scene_dir = "")
+{
+    for (const auto &obj : j["scene"]["shapes"])
+    {
+        // Red diffuse when no material is given
+        std::shared_ptr<Material> material = obj.contains("material") ? parseMaterial(obj["material"])
+                                                                       : std::make_shared<Diffuse>(Vec3(1, 0, 0));
+
+        if (obj.contains("type") && obj["type"] == "sphere" && obj.contains("center") && obj.contains("radius"))
+        {
+            world.add(std::make_shared<Sphere>(
+                Vec3(obj["center"]),
+                obj["radius"].get<float>(),
+                material));
+        }
+        else if (obj.contains("type") && obj["type"] == "cylinder" && obj.contains("center") && obj.contains("axis") &&
+                 obj.contains("radius") && obj.contains("height"))
+        {
+            world.add(std::make_shared<Cylinder>(
+                Vec3(obj["center"]),
+                Vec3(obj["axis"]),
+                obj["radius"].get<float>(),
+                obj["height"].get<float>(),
+                material));
+        }
+        else if (obj.contains("type") && obj["type"] == "triangle" &&
+                 obj.contains("v0") && obj.contains("v1") && obj.contains("v2"))
+        {
+
+            world.add(std::make_shared<Triangle>(
+                Vec3(obj["v0"]),
+                Vec3(obj["v1"]),
+                Vec3(obj["v2"]),
+                material));
+        }
+        else if (obj.contains("type") && obj["type"] == "mesh" &&
+                 (obj.contains("file") || (obj.contains("positions") && obj.contains("indices"))))
+        {
+            MeshData data;
+            if (obj.contains("file"))
+            {
+                std::string path = obj["file"];
+                if (path.empty())
+                {
+                    std::cerr << "Skipping mesh: empty file path\n";
+                    continue;
+                }
+                if (!scene_dir.empty() && path.front() != '/')
+                    path = scene_dir + "/" + path;
+                std::string error;
+                if (!load_mesh(path, data, error))
+                {
+                    std::cerr << "Skipping mesh: " << error << "\n";
+                    continue;
+                }
+            }
+            else
+            {
+                data.positions.reserve(obj["positions"].size());
+                for (const auto &p : obj["positions"])
+                    data.positions.emplace_back(p);
+                if (obj.contains("normals"))
+                {
+                    for (const auto &n : obj["normals"])
+                        data.normals.emplace_back(n);
+                }
+                if (obj.contains("uvs"))
+                    data.uvs = obj["uvs"].get<std::vector<float>>();
+                data.indices = obj["indices"].get<std::vector<uint32_t>>();
+                std::string error;
+                if (!validate_mesh(data, "inline mesh", error))
+                {
+                    std::cerr << "Skipping mesh: " << error << "\n";
+                    continue;
+                }
+            }
+
+            BVHBuildOptions options;
+            options.threads = default_thread_count();
+            auto mesh = std::make_shared<TriangleMesh>(std::move(data.positions), std::move(data.indices), material,
+                                                       std::move(data.normals), std::move(data.uvs), options);
+            if (obj.value("smooth", false) && mesh->normals.empty())
+                mesh->compute_smooth_normals();
+            if (!obj.contains("instances"))
+            {
+                world.add(mesh);
+                continue;
+            }
+            // One shared mesh and BVH, placed once per entry
+            for (const auto &inst : obj["instances"])
+            {
+                world.add(std::make_shared<Instance>(mesh, parseTransform(inst),
+                                                     inst.contains("material") ? parseMaterial(inst["material"]) : nullptr));
+            }
+        }
+    }
+}
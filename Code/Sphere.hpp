@@ -14,35 +14,44 @@ public:
     Sphere(const Vec3 &cen, float r, std::shared_ptr<Material> &mat)
         : center(cen), radius(r), mat_ptr(mat) {}
 
-    bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const override
+    // Nearest root in [t_min, t_max], shared by hit and occluded so shadow rays
+    // and closest-hit queries agree exactly, also on grazing rays
+    bool intersect(const Ray &r, double t_min, double t_max, double &t) const
     {
         Vec3 oc = r.origin - center;
         auto a = r.direction.length_squared();
         auto half_b = oc.dot(r.direction);
         auto c = oc.length_squared() - radius * radius;
         auto discriminant = half_b * half_b - a * c;
+        if (discriminant <= 0)
+            return false;
 
-        if (discriminant > 0)
-        {
-            auto sqrt_d = sqrt(discriminant);
+        auto sqrt_d = sqrt(discriminant);
+        t = (-half_b - sqrt_d) / a;
+        if (t >= t_min && t <= t_max)
+            return true;
+        t = (-half_b + sqrt_d) / a;
+        return t >= t_min && t <= t_max;
+    }
+
+    bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const override
+    {
+        double t;
+        if (!intersect(r, t_min, t_max, t))
+            return false;
 
-            // Find the nearest root that lies in the acceptable range.
-            auto root = (-half_b - sqrt_d) / a;
-            if (root < t_min || root > t_max)
-            {
-                root = (-half_b + sqrt_d) / a;
-                if (root < t_min || root > t_max)
-                    return false;
-            }
+        rec.t = t;
+        rec.p = r.at(rec.t);
+        Vec3 outward_normal = (rec.p - center) / radius;
+        rec.set_face_normal(r, outward_normal);
+        rec.mat_ptr = mat_ptr.get();
+        return true;
+    }
 
-            rec.t = root;
-            rec.p = r.at(rec.t);
-            Vec3 outward_normal = (rec.p - center) / radius;
-            rec.set_face_normal(r, outward_normal);
-            rec.mat_ptr = mat_ptr;
-            return true;
-        }
-        return false;
+    bool occluded(const Ray &r, double t_min, double t_max) const override
+    {
+        double t;
+        return intersect(r, t_min, t_max, t);
     }
 
     // bool intersect(const Ray &r, float t_min, float t_max, Hit_record &rec) const
@@ -0,0 +1,385 @@
+#pragma once
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "Sphere.hpp"
+#include "LinearBVH.hpp"
+#include "WideBVH.hpp"
+
+// Ray data shared by every lane of a sphere leaf test
+struct SphereRay
+{
+    float o[3];
+    float d[3];
+    float a; // |d|^2
+    float inv_a;
+
+    explicit SphereRay(const Ray &r)
+        : o{r.origin.x, r.origin.y, r.origin.z}, d{r.direction.x, r.direction.y, r.direction.z}
+    {
+        a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        inv_a = 1.0f / a;
+    }
+};
+
+// Sphere centers and radii in leaf order, one array per component
+struct SphereSoA
+{
+    const float *x, *y, *z, *r;
+};
+
+// Closest sphere among [first, first + count) with a root in [t_min, t_max].
+// Returns its offset from first, or -1, and writes its distance to t_hit.
+// The near root is used unless it lies before t_min, as in Sphere::hit.
+inline int intersect_spheres_scalar(const SphereSoA &s, uint32_t first, uint32_t count, const SphereRay &ray,
+                                    float t_min, float t_max, float &t_hit)
+{
+    int best = -1;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t k = first + i;
+        float ox = ray.o[0] - s.x[k], oy = ray.o[1] - s.y[k], oz = ray.o[2] - s.z[k];
+        float b = ox * ray.d[0] + oy * ray.d[1] + oz * ray.d[2];
+        float c = ox * ox + oy * oy + oz * oz - s.r[k] * s.r[k];
+        float disc = b * b - ray.a * c;
+        if (disc <= 0)
+            continue;
+        float sq = std::sqrt(disc);
+        float t = (-b - sq) * ray.inv_a;
+        if (t < t_min)
+            t = (-b + sq) * ray.inv_a;
+        if (t >= t_min && t <= t_max)
+        {
+            t_max = t;
+            best = static_cast<int>(i);
+        }
+    }
+    t_hit = t_max;
+    return best;
+}
+
+#ifdef WIDE_BVH_X86
+// Lanes past count and rays that miss keep t_max and index -1; the closest
+// lane is picked from the stored per-lane results.
+template <int W>
+inline int closest_lane(const float *t, const float *index, float &t_hit)
+{
+    int best = -1;
+    for (int i = 0; i < W; ++i)
+    {
+        if (index[i] >= 0 && (best < 0 || t[i] < t_hit))
+        {
+            t_hit = t[i];
+            best = static_cast<int>(index[i]);
+        }
+    }
+    return best;
+}
+
+inline int intersect_spheres_sse(const SphereSoA &s, uint32_t first, uint32_t count, const SphereRay &ray,
+                                 float t_min, float t_max, float &t_hit)
+{
+    const __m128 ox = _mm_set1_ps(ray.o[0]), oy = _mm_set1_ps(ray.o[1]), oz = _mm_set1_ps(ray.o[2]);
+    const __m128 dx = _mm_set1_ps(ray.d[0]), dy = _mm_set1_ps(ray.d[1]), dz = _mm_set1_ps(ray.d[2]);
+    const __m128 a = _mm_set1_ps(ray.a), inv_a = _mm_set1_ps(ray.inv_a), lo = _mm_set1_ps(t_min);
+    const __m128 n = _mm_set1_ps(static_cast<float>(count));
+    __m128 best_t = _mm_set1_ps(t_max), best_index = _mm_set1_ps(-1);
+    __m128 lane = _mm_setr_ps(0, 1, 2, 3);
+    for (uint32_t base = 0; base < count; base += 4, lane = _mm_add_ps(lane, _mm_set1_ps(4)))
+    {
+        uint32_t k = first + base;
+        __m128 cx = _mm_sub_ps(ox, _mm_loadu_ps(s.x + k));
+        __m128 cy = _mm_sub_ps(oy, _mm_loadu_ps(s.y + k));
+        __m128 cz = _mm_sub_ps(oz, _mm_loadu_ps(s.z + k));
+        __m128 r = _mm_loadu_ps(s.r + k);
+        __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, dx), _mm_mul_ps(cy, dy)), _mm_mul_ps(cz, dz));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz)), _mm_mul_ps(r, r));
+        __m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+        __m128 sq = _mm_sqrt_ps(_mm_max_ps(disc, _mm_setzero_ps()));
+        __m128 near_t = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), b), sq), inv_a);
+        __m128 far_t = _mm_mul_ps(_mm_sub_ps(sq, b), inv_a);
+        __m128 use_near = _mm_cmpge_ps(near_t, lo);
+        __m128 t = _mm_or_ps(_mm_and_ps(use_near, near_t), _mm_andnot_ps(use_near, far_t));
+        __m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(disc, _mm_setzero_ps()), _mm_cmplt_ps(lane, n)),
+                                  _mm_and_ps(_mm_cmpge_ps(t, lo), _mm_cmple_ps(t, best_t)));
+        best_t = _mm_or_ps(_mm_and_ps(valid, t), _mm_andnot_ps(valid, best_t));
+        best_index = _mm_or_ps(_mm_and_ps(valid, lane), _mm_andnot_ps(valid, best_index));
+    }
+    alignas(16) float t[4], index[4];
+    _mm_store_ps(t, best_t);
+    _mm_store_ps(index, best_index);
+    return closest_lane<4>(t, index, t_hit);
+}
+
+__attribute__((target("avx"))) inline int intersect_spheres_avx(const SphereSoA &s, uint32_t first, uint32_t count,
+                                                                 const SphereRay &ray, float t_min, float t_max, float &t_hit)
+{
+    const __m256 ox = _mm256_set1_ps(ray.o[0]), oy = _mm256_set1_ps(ray.o[1]), oz = _mm256_set1_ps(ray.o[2]);
+    const __m256 dx = _mm256_set1_ps(ray.d[0]), dy = _mm256_set1_ps(ray.d[1]), dz = _mm256_set1_ps(ray.d[2]);
+    const __m256 a = _mm256_set1_ps(ray.a), inv_a = _mm256_set1_ps(ray.inv_a), lo = _mm256_set1_ps(t_min);
+    const __m256 zero = _mm256_setzero_ps(), n = _mm256_set1_ps(static_cast<float>(count));
+    __m256 best_t = _mm256_set1_ps(t_max), best_index = _mm256_set1_ps(-1);
+    __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    for (uint32_t base = 0; base < count; base += 8, lane = _mm256_add_ps(lane, _mm256_set1_ps(8)))
+    {
+        uint32_t k = first + base;
+        __m256 cx = _mm256_sub_ps(ox, _mm256_loadu_ps(s.x + k));
+        __m256 cy = _mm256_sub_ps(oy, _mm256_loadu_ps(s.y + k));
+        __m256 cz = _mm256_sub_ps(oz, _mm256_loadu_ps(s.z + k));
+        __m256 r = _mm256_loadu_ps(s.r + k);
+        __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, dx), _mm256_mul_ps(cy, dy)), _mm256_mul_ps(cz, dz));
+        __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz)),
+                                 _mm256_mul_ps(r, r));
+        __m256 disc = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(a, c));
+        __m256 sq = _mm256_sqrt_ps(_mm256_max_ps(disc, zero));
+        __m256 near_t = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(zero, b), sq), inv_a);
+        __m256 far_t = _mm256_mul_ps(_mm256_sub_ps(sq, b), inv_a);
+        __m256 t = _mm256_blendv_ps(far_t, near_t, _mm256_cmp_ps(near_t, lo, _CMP_GE_OQ));
+        __m256 valid = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(disc, zero, _CMP_GT_OQ), _mm256_cmp_ps(lane, n, _CMP_LT_OQ)),
+                                     _mm256_and_ps(_mm256_cmp_ps(t, lo, _CMP_GE_OQ), _mm256_cmp_ps(t, best_t, _CMP_LE_OQ)));
+        best_t = _mm256_blendv_ps(best_t, t, valid);
+        best_index = _mm256_blendv_ps(best_index, lane, valid);
+    }
+    alignas(32) float t[8], index[8];
+    _mm256_store_ps(t, best_t);
+    _mm256_store_ps(index, best_index);
+    return closest_lane<8>(t, index, t_hit);
+}
+
+__attribute__((target("avx512f"))) inline int intersect_spheres_avx512(const SphereSoA &s, uint32_t first, uint32_t count,
+                                                                       const SphereRay &ray, float t_min, float t_max, float &t_hit)
+{
+    const __m512 ox = _mm512_set1_ps(ray.o[0]), oy = _mm512_set1_ps(ray.o[1]), oz = _mm512_set1_ps(ray.o[2]);
+    const __m512 dx = _mm512_set1_ps(ray.d[0]), dy = _mm512_set1_ps(ray.d[1]), dz = _mm512_set1_ps(ray.d[2]);
+    const __m512 a = _mm512_set1_ps(ray.a), inv_a = _mm512_set1_ps(ray.inv_a), lo = _mm512_set1_ps(t_min);
+    const __m512 zero = _mm512_setzero_ps();
+    __m512 best_t = _mm512_set1_ps(t_max), best_index = _mm512_set1_ps(-1);
+    __m512 lane = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    for (uint32_t base = 0; base < count; base += 16, lane = _mm512_add_ps(lane, _mm512_set1_ps(16)))
+    {
+        uint32_t k = first + base;
+        __mmask16 in_leaf = count - base >= 16 ? 0xffff : static_cast<__mmask16>((1u << (count - base)) - 1);
+        __m512 cx = _mm512_sub_ps(ox, _mm512_maskz_loadu_ps(in_leaf, s.x + k));
+        __m512 cy = _mm512_sub_ps(oy, _mm512_maskz_loadu_ps(in_leaf, s.y + k));
+        __m512 cz = _mm512_sub_ps(oz, _mm512_maskz_loadu_ps(in_leaf, s.z + k));
+        __m512 r = _mm512_maskz_loadu_ps(in_leaf, s.r + k);
+        __m512 b = _mm512_fmadd_ps(cz, dz, _mm512_fmadd_ps(cy, dy, _mm512_mul_ps(cx, dx)));
+        __m512 c = _mm512_fnmadd_ps(r, r, _mm512_fmadd_ps(cz, cz, _mm512_fmadd_ps(cy, cy, _mm512_mul_ps(cx, cx))));
+        __m512 disc = _mm512_fnmadd_ps(a, c, _mm512_mul_ps(b, b));
+        // Zero-masked forms: the unmasked max and sqrt pass an undefined source vector
+        __m512 sq = _mm512_maskz_sqrt_ps(in_leaf, _mm512_maskz_max_ps(in_leaf, disc, zero));
+        __m512 near_t = _mm512_mul_ps(_mm512_sub_ps(_mm512_sub_ps(zero, b), sq), inv_a);
+        __m512 far_t = _mm512_mul_ps(_mm512_sub_ps(sq, b), inv_a);
+        __m512 t = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(near_t, lo, _CMP_GE_OQ), far_t, near_t);
+        __mmask16 valid = in_leaf & _mm512_cmp_ps_mask(disc, zero, _CMP_GT_OQ) & _mm512_cmp_ps_mask(t, lo, _CMP_GE_OQ) &
+                          _mm512_cmp_ps_mask(t, best_t, _CMP_LE_OQ);
+        best_t = _mm512_mask_blend_ps(valid, best_t, t);
+        best_index = _mm512_mask_blend_ps(valid, best_index, lane);
+    }
+    alignas(64) float t[16], index[16];
+    _mm512_store_ps(t, best_t);
+    _mm512_store_ps(index, best_index);
+    return closest_lane<16>(t, index, t_hit);
+}
+#endif
+
+// Many spheres packed into one primitive. Centers and radii are float arrays
+// in BVH leaf order, so a leaf is a contiguous range that is tested 4, 8 or 16
+// spheres at a time with SSE, AVX or AVX-512, whichever is the widest the CPU
+// supports; leaves hold up to one vector of spheres. The winning lane is then
+// re-intersected with the Sphere::hit arithmetic so hits match single spheres.
+class SphereSet : public Hittable
+{
+public:
+    using IntersectFn = int (*)(const SphereSoA &, uint32_t, uint32_t, const SphereRay &, float, float, float &);
+
+    std::vector<float> x, y, z, radius; // padded by one vector so loads past a leaf stay in bounds
+    std::vector<std::shared_ptr<Material>> materials;
+    LinearBVHTree bvh;
+    int lanes = 1;
+    IntersectFn intersect_leaf = intersect_spheres_scalar;
+
+    // lanes: 0 picks the widest supported width, 1 the scalar loop, or 4 / 8 / 16
+    SphereSet(const std::vector<std::shared_ptr<Sphere>> &spheres, int width = 0)
+    {
+        choose_kernel(width);
+
+        std::vector<BVHPrimRef> refs;
+        refs.reserve(spheres.size());
+        for (size_t i = 0; i < spheres.size(); ++i)
+        {
+            aabb box;
+            spheres[i]->bounding_box(0, 0, box);
+            refs.push_back({box, box.centroid(), i});
+        }
+        BVHBuildOptions options;
+        options.threads = default_thread_count();
+        options.max_leaf_size = std::max(lanes, 4);
+        options.intersection_cost = 1.0 / options.max_leaf_size; // a leaf costs about one vector test
+        bvh.build(refs, options);
+
+        size_t padded = spheres.size() + 16;
+        x.assign(padded, 0);
+        y.assign(padded, 0);
+        z.assign(padded, 0);
+        radius.assign(padded, 0);
+        materials.resize(spheres.size());
+        for (size_t slot = 0; slot < bvh.indices.size(); ++slot)
+        {
+            const Sphere &sphere = *spheres[bvh.indices[slot]];
+            x[slot] = sphere.center.x;
+            y[slot] = sphere.center.y;
+            z[slot] = sphere.center.z;
+            radius[slot] = sphere.radius;
+            materials[slot] = sphere.mat_ptr;
+            bvh.indices[slot] = static_cast<uint32_t>(slot);
+        }
+        center = bvh.bounds().centroid();
+    }
+
+    size_t size() const { return materials.size(); }
+
+    bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const override
+    {
+        SphereSoA soa = arrays();
+        SphereRay ray(r);
+        uint32_t hit_slot = 0;
+        double hit_t = 0;
+        bool found = bvh.traverse_leaves(r, t_min, t_max, [&](uint32_t first, uint32_t count, double &closest)
+                                         {
+            float t;
+            int lane = intersect_leaf(soa, first, count, ray, static_cast<float>(t_min), static_cast<float>(closest), t);
+            if (lane < 0)
+                return false;
+            double exact;
+            uint32_t slot = first + lane;
+            // The float lane can disagree with the double test near t_min or a
+            // grazing edge; then another sphere of the leaf may still be the hit
+            if (!hit_sphere(slot, r, t_min, closest, exact) && !closest_in_leaf(first, count, r, t_min, closest, slot, exact))
+                return false;
+            closest = exact;
+            hit_t = exact;
+            hit_slot = slot;
+            return true; });
+        if (!found)
+            return false;
+
+        Vec3 c(x[hit_slot], y[hit_slot], z[hit_slot]);
+        rec.t = hit_t;
+        rec.p = r.at(rec.t);
+        rec.set_face_normal(r, (rec.p - c) / radius[hit_slot]);
+        rec.mat_ptr = materials[hit_slot].get();
+        return true;
+    }
+
+    bool occluded(const Ray &r, double t_min, double t_max) const override
+    {
+        SphereSoA soa = arrays();
+        SphereRay ray(r);
+        return bvh.any_hit_leaves(r, t_min, t_max, [&](uint32_t first, uint32_t count, double &closest)
+                                  {
+            float t;
+            int lane = intersect_leaf(soa, first, count, ray, static_cast<float>(t_min), static_cast<float>(closest), t);
+            if (lane < 0)
+                return false;
+            // Same double re-check as hit(), so both agree on what blocks the segment
+            double exact;
+            uint32_t slot;
+            return hit_sphere(first + lane, r, t_min, closest, exact) ||
+                   closest_in_leaf(first, count, r, t_min, closest, slot, exact); });
+    }
+
+    bool bounding_box(double t0, double t1, aabb &output_box) const override
+    {
+        if (bvh.nodes.empty())
+            return false;
+        output_box = bvh.bounds();
+        return true;
+    }
+
+private:
+    SphereSoA arrays() const { return {x.data(), y.data(), z.data(), radius.data()}; }
+
+    // Scalar double scan of a leaf, for when the winning float lane is rejected
+    bool closest_in_leaf(uint32_t first, uint32_t count, const Ray &r, double t_min, double t_max, uint32_t &slot,
+                         double &t) const
+    {
+        bool found = false;
+        for (uint32_t k = first; k < first + count; ++k)
+        {
+            double candidate;
+            if (hit_sphere(k, r, t_min, t_max, candidate))
+            {
+                t_max = candidate;
+                t = candidate;
+                slot = k;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    // Same arithmetic as Sphere::hit
+    bool hit_sphere(uint32_t slot, const Ray &r, double t_min, double t_max, double &t) const
+    {
+        Vec3 oc = r.origin - Vec3(x[slot], y[slot], z[slot]);
+        auto a = r.direction.length_squared();
+        auto half_b = oc.dot(r.direction);
+        auto c = oc.length_squared() - radius[slot] * radius[slot];
+        auto discriminant = half_b * half_b - a * c;
+        if (discriminant <= 0)
+            return false;
+
+        auto sqrt_d = sqrt(discriminant);
+        auto root = (-half_b - sqrt_d) / a;
+        if (root < t_min || root > t_max)
+        {
+            root = (-half_b + sqrt_d) / a;
+            if (root < t_min || root > t_max)
+                return false;
+        }
+        t = root;
+        return true;
+    }
+
+    void choose_kernel(int requested)
+    {
+        lanes = 1;
+        intersect_leaf = intersect_spheres_scalar;
+#ifdef WIDE_BVH_X86
+        if ((requested == 0 || requested == 16) && cpu_supports_avx512())
+        {
+            lanes = 16;
+            intersect_leaf = intersect_spheres_avx512;
+        }
+        else if ((requested == 0 || requested >= 8) && cpu_supports_avx())
+        {
+            lanes = 8;
+            intersect_leaf = intersect_spheres_avx;
+        }
+        else if (requested == 0 || requested >= 4)
+        {
+            lanes = 4;
+            intersect_leaf = intersect_spheres_sse;
+        }
+#endif
+    }
+};
+
+// Replace the Sphere objects of a scene by one SphereSet; other objects are kept
+inline std::vector<std::shared_ptr<Hittable>> pack_spheres(const std::vector<std::shared_ptr<Hittable>> &objects, int lanes = 0)
+{
+    std::vector<std::shared_ptr<Hittable>> packed;
+    std::vector<std::shared_ptr<Sphere>> spheres;
+    for (const auto &object : objects)
+    {
+        if (auto sphere = std::dynamic_pointer_cast<Sphere>(object))
+            spheres.push_back(sphere);
+        else
+            packed.push_back(object);
+    }
+    if (spheres.size() < 2)
+        return objects;
+    packed.push_back(std::make_shared<SphereSet>(spheres, lanes));
+    return packed;
+}
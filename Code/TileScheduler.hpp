@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+// Pixel rectangle [x0, x1) x [y0, y1)
+struct Tile
+{
+    int x0, y0, x1, y1;
+};
+
+// Splits the frame into tile_size x tile_size tiles and hands them out through
+// an atomic counter, so a thread that finishes early simply takes the next tile
+class TileScheduler
+{
+public:
+    TileScheduler(int width, int height, int tile_size)
+        : width(width), height(height), tile_size(std::max(tile_size, 1)),
+          tiles_x((width + this->tile_size - 1) / this->tile_size),
+          tiles_y((height + this->tile_size - 1) / this->tile_size) {}
+
+    size_t tile_count() const { return static_cast<size_t>(tiles_x) * tiles_y; }
+
+    Tile tile(size_t index) const
+    {
+        int tx = static_cast<int>(index % tiles_x);
+        int ty = static_cast<int>(index / tiles_x);
+        return Tile{tx * tile_size, ty * tile_size,
+                    std::min((tx + 1) * tile_size, width), std::min((ty + 1) * tile_size, height)};
+    }
+
+    // Claim the next unrendered tile, false once all tiles are taken
+    bool next(Tile &out)
+    {
+        size_t index = next_tile.fetch_add(1, std::memory_order_relaxed);
+        if (index >= tile_count())
+            return false;
+        out = tile(index);
+        return true;
+    }
+
+    void reset() { next_tile.store(0); }
+
+private:
+    int width, height, tile_size;
+    int tiles_x, tiles_y;
+    std::atomic<size_t> next_tile{0};
+};
+
+struct ThreadStats
+{
+    double busy_seconds = 0;
+    size_t tiles = 0;
+};
+
+// Run render_tile(tile) on num_threads workers until the scheduler is drained
+template <typename RenderTile>
+std::vector<ThreadStats> run_tiles(TileScheduler &scheduler, int num_threads, RenderTile &&render_tile)
+{
+    std::vector<ThreadStats> stats(std::max(num_threads, 1));
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        threads.emplace_back([&, i]
+                             {
+            Tile tile;
+            while (scheduler.next(tile))
+            {
+                auto start = std::chrono::high_resolution_clock::now();
+                render_tile(tile);
+                std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+                stats[i].busy_seconds += elapsed.count();
+                stats[i].tiles++;
+            } });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    return stats;
+}
+
+// Per-thread busy time; max / mean close to 1 means the load was balanced
+inline void print_thread_stats(const std::vector<ThreadStats> &stats)
+{
+    double total = 0, longest = 0;
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        std::cout << "  thread " << i << ": " << stats[i].busy_seconds << " s busy, " << stats[i].tiles << " tiles\n";
+        total += stats[i].busy_seconds;
+        longest = std::max(longest, stats[i].busy_seconds);
+    }
+    double mean = total / stats.size();
+    std::cout << "  load balance (max / mean busy time): " << (mean > 0 ? longest / mean : 1.0) << std::endl;
+}
@@ -15,9 +15,9 @@ public:
     Triangle(const Vec3 &p1, const Vec3 &p2, const Vec3 &p3, std::shared_ptr<Material> m)
         : v1(p1), v2(p2), v3(p3), mat_ptr(m) {}
 
-    bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const override
+    // Implements the Möller-Trumbore intersection algorithm, t is the ray parameter of the hit
+    bool intersect(const Ray &r, double t_min, double t_max, double &t) const
     {
-        // Implements the Möller-Trumbore intersection algorithm
         const double EPSILON = 1e-6;
         Vec3 edge1 = v2 - v1;
         Vec3 edge2 = v3 - v1;
@@ -44,30 +44,39 @@ public:
             return false;
 
         // Calculate t to find where the intersection point is on the ray
-        double t = f * edge2.dot(q);
+        t = f * edge2.dot(q);
+
+        return t >= t_min && t <= t_max;
+    }
 
-        if (t < t_min || t > t_max)
+    bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const override
+    {
+        double t;
+        if (!intersect(r, t_min, t_max, t))
             return false;
 
         // Update the hit record with intersection details
         rec.t = t;
         rec.p = r.at(t);
-        Vec3 outward_normal = edge1.cross(edge2).normalized();
+        Vec3 outward_normal = (v2 - v1).cross(v3 - v1).normalized();
         rec.set_face_normal(r, outward_normal);
-        rec.mat_ptr = mat_ptr;
+        rec.mat_ptr = mat_ptr.get();
 
         return true;
     }
+
+    bool occluded(const Ray &r, double t_min, double t_max) const override
+    {
+        double t;
+        return intersect(r, t_min, t_max, t);
+    }
+
     bool bounding_box(double t0, double t1, aabb &output_box) const override;
 };
 
 bool Triangle::bounding_box(double t0, double t1, aabb &output_box) const
 {
-    // Compute the center and radius for the bounding sphere
-    Vec3 center = (v1 + v2 + v3) / 3;
-    double radius = std::max({(center - v1).length(), (center - v2).length(), (center - v3).length()});
-
-    // Create an AABB (Axis-Aligned Bounding Box) around the triangle
-    output_box = aabb(center - Vec3(radius, radius, radius), center + Vec3(radius, radius, radius));
+    // Exact min / max of the vertices, a flat triangle gives a zero-thickness box
+    output_box = surrounding_box(surrounding_box(aabb(v1, v1), v2), v3);
     return true;
 }
@@ -0,0 +1,186 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Hitable.hpp"
+#include "LinearBVH.hpp"
+
+// Indexed triangle mesh. Vertex attributes live in shared contiguous arrays
+// and each triangle is three entries of the index buffer, so a triangle costs
+// 12 bytes plus its share of the vertices instead of a heap-allocated
+// Triangle. The mesh keeps its own BVH over triangle indices.
+class TriangleMesh : public Hittable
+{
+public:
+    std::vector<Vec3> positions;
+    std::vector<Vec3> normals; // per vertex, empty for flat shading
+    std::vector<float> uvs;    // two per vertex, may be empty
+    std::vector<uint32_t> indices;
+    std::shared_ptr<Material> mat_ptr;
+    LinearBVHTree bvh;
+
+    TriangleMesh() {}
+
+    TriangleMesh(std::vector<Vec3> positions, std::vector<uint32_t> indices, std::shared_ptr<Material> m,
+                 std::vector<Vec3> normals = {}, std::vector<float> uvs = {},
+                 const BVHBuildOptions &options = BVHBuildOptions())
+        : positions(std::move(positions)), normals(std::move(normals)), uvs(std::move(uvs)),
+          indices(std::move(indices)), mat_ptr(m)
+    {
+        build(options);
+    }
+
+    size_t triangle_count() const { return indices.size() / 3; }
+
+    // Area-weighted vertex normals for smooth shading
+    void compute_smooth_normals()
+    {
+        normals.assign(positions.size(), Vec3(0, 0, 0));
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const Vec3 &p0 = positions[indices[i]];
+            Vec3 n = (positions[indices[i + 1]] - p0).cross(positions[indices[i + 2]] - p0);
+            for (int k = 0; k < 3; ++k)
+                normals[indices[i + k]] += n;
+        }
+        for (Vec3 &n : normals)
+        {
+            if (n.length_squared() > 0)
+                n = n.normalized();
+        }
+    }
+
+    // Build the BVH and reorder the index buffer into leaf order, so a leaf
+    // slot is directly the triangle index
+    void build(const BVHBuildOptions &options = BVHBuildOptions())
+    {
+        std::vector<BVHPrimRef> refs;
+        refs.reserve(triangle_count());
+        for (size_t tri = 0; tri < triangle_count(); ++tri)
+        {
+            aabb box = triangle_box(tri);
+            refs.push_back({box, box.centroid(), tri});
+        }
+        bvh.build(refs, options);
+
+        std::vector<uint32_t> ordered(indices.size());
+        for (size_t slot = 0; slot < bvh.indices.size(); ++slot)
+        {
+            uint32_t tri = bvh.indices[slot];
+            for (int k = 0; k < 3; ++k)
+                ordered[3 * slot + k] = indices[3 * tri + k];
+            bvh.indices[slot] = static_cast<uint32_t>(slot);
+        }
+        indices.swap(ordered);
+    }
+
+    // Update the BVH after positions changed; rebuilds instead once the SAH cost
+    // has grown past max_ratio times its value after the last build. Returns true on a rebuild.
+    bool refit(double max_ratio = 1.5)
+    {
+        bvh.refit([&](uint32_t tri)
+                  { return triangle_box(tri); });
+        if (!bvh.needs_rebuild(max_ratio))
+            return false;
+        build(bvh.build_options);
+        return true;
+    }
+
+    aabb triangle_box(size_t tri) const
+    {
+        aabb box = aabb::empty();
+        for (int k = 0; k < 3; ++k)
+            box = surrounding_box(box, positions[indices[3 * tri + k]]);
+        return box;
+    }
+
+    // Möller-Trumbore, as in Triangle::intersect, also returning the barycentrics of v1 and v2
+    bool intersect(size_t tri, const Ray &r, double t_min, double t_max, double &t, double &u, double &v) const
+    {
+        const double EPSILON = 1e-6;
+        const Vec3 &v0 = positions[indices[3 * tri]];
+        Vec3 edge1 = positions[indices[3 * tri + 1]] - v0;
+        Vec3 edge2 = positions[indices[3 * tri + 2]] - v0;
+        Vec3 h = r.direction.cross(edge2);
+        double a = edge1.dot(h);
+        if (a > -EPSILON && a < EPSILON)
+            return false;
+
+        double f = 1.0 / a;
+        Vec3 s = r.origin - v0;
+        u = f * s.dot(h);
+        if (u < 0.0 || u > 1.0)
+            return false;
+
+        Vec3 q = s.cross(edge1);
+        v = f * r.direction.dot(q);
+        if (v < 0.0 || u + v > 1.0)
+            return false;
+
+        t = f * edge2.dot(q);
+        return t >= t_min && t <= t_max;
+    }
+
+    bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const override
+    {
+        size_t hit_tri = 0;
+        double hit_t = 0, hit_u = 0, hit_v = 0;
+        bool found = bvh.traverse(r, t_min, t_max, [&](uint32_t tri, double &closest)
+                                  {
+            double t, u, v;
+            if (!intersect(tri, r, t_min, closest, t, u, v))
+                return false;
+            closest = t;
+            hit_tri = tri;
+            hit_t = t;
+            hit_u = u;
+            hit_v = v;
+            return true; });
+        if (!found)
+            return false;
+
+        fill_record(hit_tri, r, hit_t, hit_u, hit_v, rec);
+        return true;
+    }
+
+    bool occluded(const Ray &r, double t_min, double t_max) const override
+    {
+        return bvh.any_hit(r, t_min, t_max, [&](uint32_t tri, double &closest)
+                           {
+            double t, u, v;
+            return intersect(tri, r, t_min, closest, t, u, v); });
+    }
+
+    bool bounding_box(double t0, double t1, aabb &output_box) const override
+    {
+        if (bvh.nodes.empty())
+            return false;
+        output_box = bvh.bounds();
+        return true;
+    }
+
+private:
+    void fill_record(size_t tri, const Ray &r, double t, double u, double v, Hit_record &rec) const
+    {
+        uint32_t i0 = indices[3 * tri], i1 = indices[3 * tri + 1], i2 = indices[3 * tri + 2];
+        float w = static_cast<float>(1.0 - u - v);
+        float fu = static_cast<float>(u), fv = static_cast<float>(v);
+
+        rec.t = t;
+        rec.p = r.at(t);
+        Vec3 outward_normal = (positions[i1] - positions[i0]).cross(positions[i2] - positions[i0]).normalized();
+        rec.set_face_normal(r, outward_normal);
+        if (!normals.empty())
+        {
+            // Interpolated shading normal on the same side as the geometric one
+            Vec3 shading = (normals[i0] * w + normals[i1] * fu + normals[i2] * fv).normalized();
+            rec.normal = rec.front_face ? shading : -shading;
+        }
+        if (!uvs.empty())
+        {
+            rec.u = uvs[2 * i0] * w + uvs[2 * i1] * fu + uvs[2 * i2] * fv;
+            rec.v = uvs[2 * i0 + 1] * w + uvs[2 * i1 + 1] * fu + uvs[2 * i2 + 1] * fv;
+        }
+        rec.mat_ptr = mat_ptr.get();
+    }
+};
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "LinearBVH.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WIDE_BVH_X86 1
+#include <immintrin.h>
+#endif
+
+// N-wide BVH node with child boxes in SoA layout so all N slab tests run in one pass
+template <int N>
+struct alignas(32) WideBVHNode
+{
+    float bounds[3][2][N]; // [axis][0 = min, 1 = max][child]
+    int32_t child[N];      // inner: wide node index, leaf: first primitive slot, empty: -1
+    uint16_t count[N];     // primitives in a leaf child, 0 for inner and empty children
+};
+
+// Slab test against all children of a node. Returns a bit mask of the children
+// hit within [t_min, t_max] and writes each child's entry distance to t_entry.
+// A NaN from 0 * inf (ray origin on a slab plane) is always the first operand of
+// min/max, so it is discarded and the other bound wins.
+template <int N>
+inline int intersect_children_scalar(const WideBVHNode<N> &node, const RayPrecomp &ray, float t_min, float t_max, float *t_entry)
+{
+    int mask = 0;
+    for (int i = 0; i < N; ++i)
+    {
+        float t0 = t_min;
+        float t1 = t_max;
+        for (int a = 0; a < 3; ++a)
+        {
+            float near_t = (node.bounds[a][ray.sign[a]][i] - ray.origin[a]) * ray.inv_dir[a];
+            float far_t = (node.bounds[a][1 - ray.sign[a]][i] - ray.origin[a]) * ray.inv_dir[a];
+            t0 = near_t > t0 ? near_t : t0;
+            t1 = far_t < t1 ? far_t : t1;
+        }
+        t_entry[i] = t0;
+        if (t0 <= t1)
+            mask |= 1 << i;
+    }
+    return mask;
+}
+
+#ifdef WIDE_BVH_X86
+inline int intersect_children_sse(const WideBVHNode<4> &node, const RayPrecomp &ray, float t_min, float t_max, float *t_entry)
+{
+    __m128 t0 = _mm_set1_ps(t_min);
+    __m128 t1 = _mm_set1_ps(t_max);
+    for (int a = 0; a < 3; ++a)
+    {
+        __m128 o = _mm_set1_ps(ray.origin[a]);
+        __m128 inv = _mm_set1_ps(ray.inv_dir[a]);
+        __m128 near_t = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[a][ray.sign[a]]), o), inv);
+        __m128 far_t = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[a][1 - ray.sign[a]]), o), inv);
+        // maxps/minps return the second operand when the first is NaN
+        t0 = _mm_max_ps(near_t, t0);
+        t1 = _mm_min_ps(far_t, t1);
+    }
+    _mm_storeu_ps(t_entry, t0);
+    return _mm_movemask_ps(_mm_cmple_ps(t0, t1));
+}
+
+__attribute__((target("avx"))) inline int intersect_children_avx(const WideBVHNode<8> &node, const RayPrecomp &ray,
+                                                                  float t_min, float t_max, float *t_entry)
+{
+    __m256 t0 = _mm256_set1_ps(t_min);
+    __m256 t1 = _mm256_set1_ps(t_max);
+    for (int a = 0; a < 3; ++a)
+    {
+        __m256 o = _mm256_set1_ps(ray.origin[a]);
+        __m256 inv = _mm256_set1_ps(ray.inv_dir[a]);
+        __m256 near_t = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[a][ray.sign[a]]), o), inv);
+        __m256 far_t = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[a][1 - ray.sign[a]]), o), inv);
+        t0 = _mm256_max_ps(near_t, t0);
+        t1 = _mm256_min_ps(far_t, t1);
+    }
+    _mm256_storeu_ps(t_entry, t0);
+    return _mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ));
+}
+#endif
+
+inline bool cpu_supports_avx()
+{
+#if defined(WIDE_BVH_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx");
+#else
+    return false;
+#endif
+}
+
+inline bool cpu_supports_avx512()
+{
+#if defined(WIDE_BVH_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
+}
+
+// BVH4 / BVH8 collapsed from a binary LinearBVH. Children of a node are tested
+// together with SSE (N = 4) or AVX (N = 8) when the CPU supports it, otherwise
+// with the scalar loop, and are visited nearest-first.
+template <int N>
+class WideBVH : public Hittable
+{
+public:
+    using IntersectFn = int (*)(const WideBVHNode<N> &, const RayPrecomp &, float, float, float *);
+
+    std::vector<WideBVHNode<N>> nodes;
+    std::vector<shared_ptr<Hittable>> primitives; // same slot order as the source LinearBVH
+    aabb box;
+    IntersectFn intersect_children = intersect_children_scalar<N>;
+    int depth = 0; // wide nodes on the longest root-to-leaf path
+
+    WideBVH() {}
+
+    WideBVH(const LinearBVH &binary, bool allow_simd = true)
+        : primitives(binary.primitives), box(binary.tree.bounds())
+    {
+        if (!binary.tree.nodes.empty())
+            collapse(binary.tree, 0, 1);
+
+#ifdef WIDE_BVH_X86
+        if constexpr (N == 4)
+        {
+            if (allow_simd)
+                intersect_children = intersect_children_sse;
+        }
+        else if constexpr (N == 8)
+        {
+            if (allow_simd && cpu_supports_avx())
+                intersect_children = intersect_children_avx;
+        }
+#endif
+    }
+
+    bool uses_simd() const { return intersect_children != intersect_children_scalar<N>; }
+
+    bool hit(const Ray &r, double t_min, double t_max, Hit_record &rec) const override
+    {
+        return traverse<false>(r, t_min, t_max, &rec);
+    }
+
+    bool occluded(const Ray &r, double t_min, double t_max) const override
+    {
+        return traverse<true>(r, t_min, t_max, nullptr);
+    }
+
+    bool bounding_box(double t0, double t1, aabb &output_box) const override
+    {
+        if (nodes.empty())
+            return false;
+        output_box = box;
+        return true;
+    }
+
+private:
+    // Nearest-first traversal; with AnyHit it returns at the first primitive hit and rec is unused
+    template <bool AnyHit>
+    bool traverse(const Ray &r, double t_min, double t_max, Hit_record *rec) const
+    {
+        if (nodes.empty())
+            return false;
+
+        struct Entry
+        {
+            int32_t child;
+            uint16_t count;
+            float t;
+        };
+
+        RayPrecomp ray(r);
+        // A popped node pushes at most N entries, so depth * (N - 1) + 1 bounds
+        // the stack; trees deeper than the fixed buffer use a heap stack
+        Entry fixed_stack[64 * N];
+        std::vector<Entry> deep_stack;
+        Entry *stack = fixed_stack;
+        if (depth * (N - 1) + 1 > 64 * N)
+        {
+            deep_stack.resize(depth * (N - 1) + 1);
+            stack = deep_stack.data();
+        }
+        int stack_size = 0;
+        stack[stack_size++] = {0, 0, static_cast<float>(t_min)};
+
+        bool hit_anything = false;
+        double closest = t_max;
+        while (stack_size > 0)
+        {
+            Entry entry = stack[--stack_size];
+            if (entry.t > closest)
+                continue;
+
+            if (entry.count > 0)
+            {
+                for (int i = 0; i < entry.count; ++i)
+                {
+                    if constexpr (AnyHit)
+                    {
+                        if (primitives[entry.child + i]->occluded(r, t_min, closest))
+                            return true;
+                    }
+                    else if (primitives[entry.child + i]->hit(r, t_min, closest, *rec))
+                    {
+                        hit_anything = true;
+                        closest = rec->t;
+                    }
+                }
+                continue;
+            }
+
+            const WideBVHNode<N> &node = nodes[entry.child];
+            alignas(32) float t_entry[N];
+            int mask = intersect_children(node, ray, static_cast<float>(t_min), static_cast<float>(closest), t_entry);
+
+            // Push hit children farthest first so the nearest one is popped next
+            Entry hits[N];
+            int n_hits = 0;
+            while (mask)
+            {
+                int i = __builtin_ctz(mask);
+                mask &= mask - 1;
+                Entry e = {node.child[i], node.count[i], t_entry[i]};
+                int j = n_hits++;
+                while (j > 0 && hits[j - 1].t < e.t)
+                {
+                    hits[j] = hits[j - 1];
+                    --j;
+                }
+                hits[j] = e;
+            }
+            for (int i = 0; i < n_hits; ++i)
+                stack[stack_size++] = hits[i];
+        }
+        return hit_anything;
+    }
+
+    static void set_child(WideBVHNode<N> &node, int i, const aabb &b, int32_t child, uint16_t count)
+    {
+        const Vec3 lo = b.min();
+        const Vec3 hi = b.max();
+        node.bounds[0][0][i] = lo.x;
+        node.bounds[0][1][i] = hi.x;
+        node.bounds[1][0][i] = lo.y;
+        node.bounds[1][1][i] = hi.y;
+        node.bounds[2][0][i] = lo.z;
+        node.bounds[2][1][i] = hi.z;
+        node.child[i] = child;
+        node.count[i] = count;
+    }
+
+    // Pull up to N descendants of a binary node into one wide node, always
+    // opening the inner child with the largest surface area
+    int32_t collapse(const LinearBVHTree &tree, uint32_t binary_index, int level)
+    {
+        depth = std::max(depth, level);
+        int32_t index = static_cast<int32_t>(nodes.size());
+        nodes.emplace_back();
+
+        std::vector<uint32_t> children;
+        const LinearBVHNode &root = tree.nodes[binary_index];
+        if (root.n_primitives > 0)
+            children.push_back(binary_index);
+        else
+            children = {binary_index + 1, root.second_child_offset};
+
+        while (children.size() < static_cast<size_t>(N))
+        {
+            int best = -1;
+            double best_area = -1;
+            for (size_t i = 0; i < children.size(); ++i)
+            {
+                const LinearBVHNode &c = tree.nodes[children[i]];
+                double area = LinearBVHTree::node_box(c).surface_area();
+                if (c.n_primitives == 0 && area > best_area)
+                {
+                    best = static_cast<int>(i);
+                    best_area = area;
+                }
+            }
+            if (best < 0)
+                break;
+
+            uint32_t opened = children[best];
+            children[best] = opened + 1;
+            children.push_back(tree.nodes[opened].second_child_offset);
+        }
+
+        for (int i = 0; i < N; ++i)
+        {
+            if (i >= static_cast<int>(children.size()))
+            {
+                set_child(nodes[index], i, aabb::empty(), -1, 0);
+                continue;
+            }
+            const LinearBVHNode &c = tree.nodes[children[i]];
+            aabb child_box = LinearBVHTree::node_box(c);
+            if (c.n_primitives > 0)
+                set_child(nodes[index], i, child_box, static_cast<int32_t>(c.primitives_offset), c.n_primitives);
+            else
+            {
+                int32_t child = collapse(tree, children[i], level + 1);
+                set_child(nodes[index], i, child_box, child, 0);
+            }
+        }
+        return index;
+    }
+};
+
+using BVH4 = WideBVH<4>;
+using BVH8 = WideBVH<8>;
@@ -17,37 +17,46 @@ public:
     Vec3 min() const { return _min; }
     Vec3 max() const { return _max; }
 
-    bool hit(const Ray &r, double tmin, double tmax) const
+    // Inverted box that the first surrounding_box call replaces
+    static aabb empty() { return aabb(Vec3(inf, inf, inf), Vec3(-inf, -inf, -inf)); }
+
+    Vec3 centroid() const { return (_min + _max) * 0.5f; }
+
+    double surface_area() const
     {
-        auto tx0 = fmin((_min.x - r.origin.x) / r.direction.x,
-                        (_max.x - r.origin.x) / r.direction.x);
-        auto tx1 = fmax((_min.x - r.origin.x) / r.direction.x,
-                        (_max.x - r.origin.x) / r.direction.x);
-        tmin = fmax(tx0, tmin);
-        tmax = fmin(tx1, tmax);
-        if (tmax <= tmin)
-            return false;
+        Vec3 d = _max - _min;
+        return 2.0 * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
 
-        // Check intersection along the y-axis
-        auto ty0 = fmin((_min.y - r.origin.y) / r.direction.y,
-                        (_max.y - r.origin.y) / r.direction.y);
-        auto ty1 = fmax((_min.y - r.origin.y) / r.direction.y,
-                        (_max.y - r.origin.y) / r.direction.y);
-        tmin = fmax(ty0, tmin);
-        tmax = fmin(ty1, tmax);
-        if (tmax <= tmin)
-            return false;
+    // Index of the longest extent, used as split axis fallback
+    int longest_axis() const
+    {
+        Vec3 d = _max - _min;
+        if (d.x > d.y && d.x > d.z)
+            return 0;
+        return d.y > d.z ? 1 : 2;
+    }
 
-        // Check intersection along the z-axis
-        auto tz0 = fmin((_min.z - r.origin.z) / r.direction.z,
-                        (_max.z - r.origin.z) / r.direction.z);
-        auto tz1 = fmax((_min.z - r.origin.z) / r.direction.z,
-                        (_max.z - r.origin.z) / r.direction.z);
-        tmin = fmax(tz0, tmin);
-        tmax = fmin(tz1, tmax);
-        if (tmax <= tmin)
-            return false;
-        return true;
+    bool hit(const Ray &r, double tmin, double tmax) const
+    {
+        return hit(RayPrecomp(r), static_cast<float>(tmin), static_cast<float>(tmax));
+    }
+
+    // Branch-free slab test. For an axis-parallel ray whose origin lies on a
+    // slab plane, (bound - origin) * inv_dir is 0 * inf = NaN; the comparisons
+    // below are false for NaN, so that plane is ignored instead of rejecting the box.
+    bool hit(const RayPrecomp &r, float tmin, float tmax) const
+    {
+        const float lo[3] = {_min.x, _min.y, _min.z};
+        const float hi[3] = {_max.x, _max.y, _max.z};
+        for (int a = 0; a < 3; ++a)
+        {
+            float near_t = ((r.sign[a] ? hi[a] : lo[a]) - r.origin[a]) * r.inv_dir[a];
+            float far_t = ((r.sign[a] ? lo[a] : hi[a]) - r.origin[a]) * r.inv_dir[a];
+            tmin = near_t > tmin ? near_t : tmin;
+            tmax = far_t < tmax ? far_t : tmax;
+        }
+        return tmin <= tmax;
     }
 
     bool hit(Vec3 center)
@@ -83,4 +92,18 @@ aabb surrounding_box(aabb box0, aabb box1)
              fmax(box0.max().z, box1.max().z));
 
     return aabb(small, big);
+}
+
+// Grow a box so that it also contains a point
+aabb surrounding_box(aabb box, const Vec3 &p)
+{
+    Vec3 small(fmin(box.min().x, p.x), fmin(box.min().y, p.y), fmin(box.min().z, p.z));
+    Vec3 big(fmax(box.max().x, p.x), fmax(box.max().y, p.y), fmax(box.max().z, p.z));
+    return aabb(small, big);
+}
+
+// Component of a vector by axis index (0 = x, 1 = y, 2 = z)
+inline float axis_value(const Vec3 &v, int axis)
+{
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <limits>
 #include <memory>
 #include <chrono>
+#include <cstdint>
 
 using std::make_shared;
 using std::shared_ptr;
@@ -18,9 +19,60 @@ inline double degrees_to_radians(double degrees)
     return degrees * pi / 180;
 }
 
+// PCG32 generator (O'Neill, pcg-random.org): 64-bit state, selectable stream
+class Pcg32
+{
+public:
+    uint64_t state;
+    uint64_t inc;
+
+    Pcg32(uint64_t seed_value = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL)
+    {
+        seed(seed_value, stream);
+    }
+
+    void seed(uint64_t seed_value, uint64_t stream)
+    {
+        state = 0;
+        inc = (stream << 1u) | 1u;
+        next();
+        state += seed_value;
+        next();
+    }
+
+    uint32_t next()
+    {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + inc;
+        uint32_t xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = static_cast<uint32_t>(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    }
+
+    // Uniform in [0, 1)
+    double next_double()
+    {
+        return next() * (1.0 / 4294967296.0);
+    }
+};
+
+// Each thread draws from its own generator, so render threads share no state
+inline Pcg32 &thread_rng()
+{
+    thread_local Pcg32 rng;
+    return rng;
+}
+
+// Renderers reseed per pixel with (seed, pixel index) so the image does not
+// depend on how pixels are distributed over threads
+inline void seed_thread_rng(uint64_t seed, uint64_t stream)
+{
+    thread_rng().seed(seed, stream);
+}
+
 inline double random_double()
 {
-    return rand() / (RAND_MAX + 1.0);
+    return thread_rng().next_double();
 }
 
 inline double random_double(double min, double max)
@@ -49,5 +101,6 @@ inline int random_int(int min, int max)
     return static_cast<int>(random_double(min, max + 1));
 }
 
+#include "Sampler.hpp"
 #include "Ray.hpp"
 #include "vec3.hpp"
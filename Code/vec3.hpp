@@ -141,8 +141,28 @@ Vec3 random_in_unit_sphere()
     }
 }
 
+// Point on the unit lens disk. Low-discrepancy samplers use the concentric
+// mapping (Shirley and Chiu), which keeps their stratification; rejection would break it.
 Vec3 Camera_Sampling()
 {
+    if (low_discrepancy_sampling())
+    {
+        double a = 2 * sample_1d() - 1, b = 2 * sample_1d() - 1;
+        if (a == 0 && b == 0)
+            return Vec3(0, 0, 0);
+        double r, phi;
+        if (std::abs(a) > std::abs(b))
+        {
+            r = a;
+            phi = pi / 4 * (b / a);
+        }
+        else
+        {
+            r = b;
+            phi = pi / 2 - pi / 4 * (a / b);
+        }
+        return Vec3(r * std::cos(phi), r * std::sin(phi), 0);
+    }
     while (true)
     {
         auto p = Vec3(random_double(-1, 1), random_double(-1, 1), 0);
@@ -154,8 +174,8 @@ Vec3 Camera_Sampling()
 
 Vec3 random_unit_vector()
 {
-    auto a = random_double(0, 2 * pi);
-    auto z = random_double(-1, 1);
+    auto a = 2 * pi * sample_1d();
+    auto z = -1 + 2 * sample_1d();
     auto r = sqrt(1 - z * z);
     return Vec3(r * cos(a), r * sin(a), z);
 }